@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Seed used for all generated benchmark data, so every run measures the exact same workload
+static constexpr uint32_t BENCHMARK_SEED = 1337;
+
+struct BenchmarkResult
+{
+	const char* name;
+	double medianMs;
+	double minMs;
+	double maxMs;
+};
+
+// Runs the function once to warm up the caches and then the given amount of repetitions. The median is reported
+// because it is not skewed by the occasional run that got preempted
+template<typename Function>
+BenchmarkResult RunBenchmark(const char* name, uint32_t repetitions, Function&& function)
+{
+	function();
+
+	std::vector<double> timings(repetitions);
+	for (uint32_t i = 0; i < repetitions; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		timings[i] = std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count();
+	}
+
+	std::sort(timings.begin(), timings.end());
+	return BenchmarkResult{ name, timings[repetitions / 2], timings.front(), timings.back() };
+}
+
+inline void PrintBenchmarkResult(const BenchmarkResult& result, const BenchmarkResult* baseline = nullptr)
+{
+	std::printf("  %-36s median %9.3f ms  (min %9.3f, max %9.3f)", result.name, result.medianMs, result.minMs, result.maxMs);
+
+	if (baseline != nullptr && result.medianMs > 0.0)
+	{
+		std::printf("  %5.2fx", baseline->medianMs / result.medianMs);
+	}
+
+	std::printf("\n");
+}
+
+// Items per second at the median time, itemName in plural (like "vertices")
+inline void PrintThroughput(const BenchmarkResult& result, double itemCount, const char* itemName)
+{
+	if (result.medianMs > 0.0)
+	{
+		std::printf("  %-36s %9.2f M %s/s\n", "", itemCount / result.medianMs / 1000.0, itemName);
+	}
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+inline const volatile void* volatile g_benchmarkSink = nullptr;
+#endif
+
+// Prevents the compiler from optimizing away work whose result is otherwise unused. The value has to be in memory and
+// all memory counts as read, so the stores into something like the buffer of a vector can't be skipped either
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	// No inline assembly on x64, so the value escapes through a volatile pointer followed by a compiler barrier
+	g_benchmarkSink = &reinterpret_cast<const volatile char&>(value);
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "m"(value) : "memory");
+#endif
+}
+
+void RunTransformBenchmarks();
+void RunRegistryBenchmarks();
+void RunBvhBenchmarks();
+void RunOcclusionBenchmarks();
+void RunModelBenchmarks();
+void RunCameraBenchmarks();
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "Benchmark.h"
+
+#include "BoundingVolumeHierarchy.h"
+#include "Camera.h"
+
+#include <random>
+
+namespace
+{
+	void RunBvhBenchmark(uint32_t objectCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> positionDistribution(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> sizeDistribution(0.5f, 4.0f);
+		std::uniform_real_distribution<float> moveDistribution(-1.0f, 1.0f);
+
+		std::vector<AABB> bounds(objectCount);
+		for (auto& box : bounds)
+		{
+			glm::vec3 center{ positionDistribution(random), positionDistribution(random), positionDistribution(random) };
+			glm::vec3 extent{ sizeDistribution(random), sizeDistribution(random), sizeDistribution(random) };
+			box = AABB{ center - extent, center + extent };
+		}
+
+		std::printf("%u objects, %u repetitions\n", objectCount, repetitions);
+
+		std::vector<uint32_t> proxies(objectCount);
+		BoundingVolumeHierarchy bvh;
+		BenchmarkResult insert = RunBenchmark("Build (one insert at a time)", 1, [&]()
+		{
+			bvh = BoundingVolumeHierarchy{};
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				proxies[i] = bvh.createProxy(bounds[i], i);
+			}
+		});
+		PrintBenchmarkResult(insert);
+		std::printf("  Tree height %u\n", bvh.getHeight());
+
+		BenchmarkResult build = RunBenchmark("Build (deferred + rebuild)", repetitions, [&]()
+		{
+			bvh = BoundingVolumeHierarchy{};
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				proxies[i] = bvh.createProxy(bounds[i], i, true);
+			}
+			bvh.rebuild();
+		});
+		PrintBenchmarkResult(build, &insert);
+		std::printf("  Tree height %u\n", bvh.getHeight());
+
+		Camera camera{};
+		camera.setPerspectiveProjection(glm::radians(50.0f), 1.0f, 0.1f, 300.0f);
+		camera.setViewYXZ(glm::vec3(0.0f), glm::vec3(0.0f, 0.3f, 0.0f));
+		Frustum frustum = Frustum::FromViewProjection(camera.getProjectionMatrix() * camera.getViewMatrix());
+
+		// Every query is compared against a linear scan over the exact bounds, the tree may return a few more
+		// objects because it tests the fat bounds
+		std::vector<uint32_t> linearResult;
+		std::vector<uint32_t> bvhResult;
+		auto checkResults = [&](const char* query)
+		{
+			std::vector<bool> found(objectCount, false);
+			for (uint32_t object : bvhResult)
+			{
+				found[object] = true;
+			}
+
+			uint32_t missing = 0;
+			for (uint32_t object : linearResult)
+			{
+				missing += found[object] ? 0 : 1;
+			}
+
+			std::printf("  %s: linear %zu, bvh %zu, missing %u\n", query, linearResult.size(), bvhResult.size(), missing);
+		};
+
+		BenchmarkResult linearFrustum = RunBenchmark("Frustum linear", repetitions, [&]()
+		{
+			linearResult.clear();
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				uint32_t planeMask = Frustum::ALL_PLANES;
+				if (frustum.classify(bounds[i], planeMask) != Frustum::Containment::Outside)
+				{
+					linearResult.push_back(i);
+				}
+			}
+		});
+		PrintBenchmarkResult(linearFrustum);
+
+		BenchmarkResult bvhFrustum = RunBenchmark("Frustum bvh", repetitions, [&]()
+		{
+			bvhResult.clear();
+			bvh.queryFrustum(frustum, [&](uint32_t object) { bvhResult.push_back(object); });
+		});
+		PrintBenchmarkResult(bvhFrustum, &linearFrustum);
+		checkResults("Frustum");
+
+		glm::vec3 sphereCenter{ 10.0f, -20.0f, 30.0f };
+		float sphereRadius = 40.0f;
+
+		BenchmarkResult linearSphere = RunBenchmark("Sphere linear", repetitions, [&]()
+		{
+			linearResult.clear();
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				if (bounds[i].intersectsSphere(sphereCenter, sphereRadius))
+				{
+					linearResult.push_back(i);
+				}
+			}
+		});
+		PrintBenchmarkResult(linearSphere);
+
+		BenchmarkResult bvhSphere = RunBenchmark("Sphere bvh", repetitions, [&]()
+		{
+			bvhResult.clear();
+			bvh.querySphere(sphereCenter, sphereRadius, [&](uint32_t object) { bvhResult.push_back(object); });
+		});
+		PrintBenchmarkResult(bvhSphere, &linearSphere);
+		checkResults("Sphere");
+
+		// Closest hit of a ray through the whole scene
+		Ray ray{ glm::vec3(-600.0f, 3.0f, -2.0f), glm::normalize(glm::vec3(1.0f, 0.01f, 0.02f)) };
+		glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+		uint32_t linearHit = 0;
+		BenchmarkResult linearRay = RunBenchmark("Ray closest hit linear", repetitions, [&]()
+		{
+			float closest = std::numeric_limits<float>::max();
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				float distance;
+				if (bounds[i].intersectsRay(ray.origin, inverseDirection, closest, distance) && distance < closest)
+				{
+					closest = distance;
+					linearHit = i;
+				}
+			}
+		});
+		PrintBenchmarkResult(linearRay);
+
+		uint32_t bvhHit = 0;
+		BenchmarkResult bvhRay = RunBenchmark("Ray closest hit bvh", repetitions, [&]()
+		{
+			bvh.raycast(ray, std::numeric_limits<float>::max(), [&](uint32_t object, float maxDistance)
+			{
+				float distance;
+				if (bounds[object].intersectsRay(ray.origin, inverseDirection, maxDistance, distance) && distance < maxDistance)
+				{
+					bvhHit = object;
+					return distance;
+				}
+				return maxDistance;
+			});
+		});
+		PrintBenchmarkResult(bvhRay, &linearRay);
+		std::printf("  Ray: linear hit %u, bvh hit %u\n", linearHit, bvhHit);
+
+		// A tenth of the objects moves a little every frame
+		uint32_t refitCount = 0;
+		uint32_t rebuildCount = 0;
+		BenchmarkResult move = RunBenchmark("Move 10% + optimize", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < objectCount; i += 10)
+			{
+				glm::vec3 offset{ moveDistribution(random), moveDistribution(random), moveDistribution(random) };
+				bounds[i].min += offset;
+				bounds[i].max += offset;
+
+				refitCount += bvh.moveProxy(proxies[i], bounds[i]) ? 1 : 0;
+			}
+
+			rebuildCount += bvh.optimize() ? 1 : 0;
+		});
+		PrintBenchmarkResult(move);
+		std::printf("  %u refits, %u rebuilds, tree height %u\n", refitCount, rebuildCount, bvh.getHeight());
+
+		bvhResult.clear();
+		bvh.queryFrustum(frustum, [&](uint32_t object) { bvhResult.push_back(object); });
+		linearResult.clear();
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			uint32_t planeMask = Frustum::ALL_PLANES;
+			if (frustum.classify(bounds[i], planeMask) != Frustum::Containment::Outside)
+			{
+				linearResult.push_back(i);
+			}
+		}
+		checkResults("Frustum after moving");
+
+		std::printf("\n");
+	}
+}
+
+void RunBvhBenchmarks()
+{
+	std::printf("=== Bounding volume hierarchy ===\n");
+
+	RunBvhBenchmark(10000, 50);
+	RunBvhBenchmark(100000, 20);
+	RunBvhBenchmark(1000000, 5);
+}
\ No newline at end of file
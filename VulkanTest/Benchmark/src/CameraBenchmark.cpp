@@ -0,0 +1,88 @@
+#include "Benchmark.h"
+
+#include "Camera.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <random>
+
+namespace
+{
+	struct CameraPose
+	{
+		glm::vec3 position;
+		glm::vec3 rotation;
+		float fovy;
+		float aspect;
+	};
+
+	void RunCameraBenchmark(uint32_t cameraCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> rotationDistribution(-glm::two_pi<float>(), glm::two_pi<float>());
+		std::uniform_real_distribution<float> fovDistribution(glm::radians(30.0f), glm::radians(90.0f));
+		std::uniform_real_distribution<float> aspectDistribution(0.5f, 2.5f);
+
+		std::vector<CameraPose> poses(cameraCount);
+		for (auto& pose : poses)
+		{
+			pose.position = { positionDistribution(random), positionDistribution(random), positionDistribution(random) };
+			pose.rotation = { rotationDistribution(random), rotationDistribution(random), rotationDistribution(random) };
+			pose.fovy = fovDistribution(random);
+			pose.aspect = aspectDistribution(random);
+		}
+
+		// Each result is kept so the work can't be skipped
+		std::vector<glm::mat4> matrices(cameraCount);
+		Camera camera{};
+
+		std::printf("%u cameras, %u repetitions\n", cameraCount, repetitions);
+
+		BenchmarkResult view = RunBenchmark("Camera::setViewYXZ", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < cameraCount; i++)
+			{
+				camera.setViewYXZ(poses[i].position, poses[i].rotation);
+				matrices[i] = camera.getViewMatrix();
+			}
+			DoNotOptimize(matrices);
+		});
+		PrintBenchmarkResult(view);
+		PrintThroughput(view, cameraCount, "calls");
+
+		BenchmarkResult projection = RunBenchmark("Camera::setPerspectiveProjection", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < cameraCount; i++)
+			{
+				camera.setPerspectiveProjection(poses[i].fovy, poses[i].aspect, 0.1f, 100.0f);
+				matrices[i] = camera.getProjectionMatrix();
+			}
+			DoNotOptimize(matrices);
+		});
+		PrintBenchmarkResult(projection);
+		PrintThroughput(projection, cameraCount, "calls");
+
+		// What the application does every frame
+		BenchmarkResult both = RunBenchmark("Both + view projection", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < cameraCount; i++)
+			{
+				camera.setPerspectiveProjection(poses[i].fovy, poses[i].aspect, 0.1f, 100.0f);
+				camera.setViewYXZ(poses[i].position, poses[i].rotation);
+				matrices[i] = camera.getProjectionMatrix() * camera.getViewMatrix();
+			}
+			DoNotOptimize(matrices);
+		});
+		PrintBenchmarkResult(both);
+		PrintThroughput(both, cameraCount, "cameras");
+		std::printf("\n");
+	}
+}
+
+void RunCameraBenchmarks()
+{
+	std::printf("=== Camera ===\n");
+
+	RunCameraBenchmark(100000, 50);
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+
+#include "Model.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	// A bumpy grid of quads with positions, uvs and normals, every face corner indexes all three like an exported mesh.
+	// Returns the size of the file in bytes
+	uintmax_t WriteGridObj(const std::filesystem::path& path, uint32_t gridSize)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> heightDistribution(-0.05f, 0.05f);
+
+		std::ofstream file{ path };
+		uint32_t rowLength = gridSize + 1;
+
+		for (uint32_t z = 0; z <= gridSize; z++)
+		{
+			for (uint32_t x = 0; x <= gridSize; x++)
+			{
+				float u = static_cast<float>(x) / gridSize;
+				float v = static_cast<float>(z) / gridSize;
+
+				file << "v " << u - 0.5f << " " << heightDistribution(random) << " " << v - 0.5f << "\n";
+				file << "vt " << u << " " << v << "\n";
+				file << "vn 0 -1 0\n";
+			}
+		}
+
+		// Obj indices start at 1
+		for (uint32_t z = 0; z < gridSize; z++)
+		{
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				uint32_t corners[4] = { z * rowLength + x + 1, z * rowLength + x + 2, (z + 1) * rowLength + x + 2, (z + 1) * rowLength + x + 1 };
+
+				file << "f";
+				for (uint32_t corner : corners)
+				{
+					file << " " << corner << "/" << corner << "/" << corner;
+				}
+				file << "\n";
+			}
+		}
+
+		file.close();
+		return std::filesystem::file_size(path);
+	}
+
+	void RunLoadModelBenchmark(uint32_t gridSize, uint32_t repetitions)
+	{
+		std::filesystem::path path = std::filesystem::temp_directory_path() / ("benchmark_grid_" + std::to_string(gridSize) + ".obj");
+		uintmax_t fileSize = WriteGridObj(path, gridSize);
+
+		Model::Data data{};
+		std::printf("%ux%u grid (%.2f MB), %u repetitions\n", gridSize, gridSize, fileSize / (1024.0 * 1024.0), repetitions);
+
+		BenchmarkResult load = RunBenchmark("Model::Data::loadModel", repetitions, [&]()
+		{
+			data.loadModel(path.string());
+			DoNotOptimize(data);
+		});
+		PrintBenchmarkResult(load);
+		PrintThroughput(load, static_cast<double>(fileSize), "bytes");
+		PrintThroughput(load, data.indices.size() / 3, "triangles");
+
+		uint32_t expectedVertexCount = (gridSize + 1) * (gridSize + 1);
+		std::printf("  %zu vertices (%s), %zu indices\n", data.vertices.size(),
+			data.vertices.size() == expectedVertexCount ? "all shared corners merged" : "NOT DEDUPLICATED", data.indices.size());
+
+		// The dedup on its own, over the same stream of face corners the loader goes through
+		std::vector<Model::Vertex> corners(data.indices.size());
+		for (size_t i = 0; i < data.indices.size(); i++)
+		{
+			corners[i] = data.vertices[data.indices[i]];
+		}
+
+		size_t combined = 0;
+		BenchmarkResult hash = RunBenchmark("std::hash<Model::Vertex>", repetitions * 4, [&]()
+		{
+			for (const Model::Vertex& vertex : corners)
+			{
+				combined ^= std::hash<Model::Vertex>{}(vertex);
+			}
+			DoNotOptimize(combined);
+		});
+		PrintBenchmarkResult(hash);
+		PrintThroughput(hash, corners.size(), "vertices");
+
+		// Same lookups as the loader
+		std::vector<Model::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		BenchmarkResult dedup = RunBenchmark("Dedup (unordered_map)", repetitions * 4, [&]()
+		{
+			vertices.clear();
+			indices.clear();
+
+			std::unordered_map<Model::Vertex, uint32_t> uniqueVertices{};
+			for (const Model::Vertex& vertex : corners)
+			{
+				if (uniqueVertices.count(vertex) == 0)
+				{
+					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+					vertices.push_back(vertex);
+				}
+
+				indices.push_back(uniqueVertices[vertex]);
+			}
+			DoNotOptimize(indices);
+		});
+		PrintBenchmarkResult(dedup);
+		PrintThroughput(dedup, corners.size(), "vertices");
+
+		// Vertices that hash the same end up in the same bucket, so collisions directly slow down the dedup
+		std::unordered_set<size_t> hashes;
+		for (const Model::Vertex& vertex : data.vertices)
+		{
+			hashes.insert(std::hash<Model::Vertex>{}(vertex));
+		}
+		std::printf("  %zu distinct hashes for %zu distinct vertices\n\n", hashes.size(), data.vertices.size());
+
+		std::filesystem::remove(path);
+	}
+}
+
+void RunModelBenchmarks()
+{
+	std::printf("=== Model loading ===\n");
+
+	RunLoadModelBenchmark(32, 50);
+	RunLoadModelBenchmark(128, 20);
+	RunLoadModelBenchmark(512, 5);
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "Camera.h"
+#include "Simd.h"
+
+#include <random>
+
+namespace
+{
+	// A grid of buildings in front of the camera with small objects scattered between and behind them
+	void RunOcclusionBenchmark(uint32_t occluderCount, uint32_t objectCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> depthDistribution(5.0f, 200.0f);
+		std::uniform_real_distribution<float> sizeDistribution(2.0f, 8.0f);
+
+		std::vector<OcclusionMesh> occluders(occluderCount);
+		for (auto& occluder : occluders)
+		{
+			glm::vec3 center{ positionDistribution(random), 0.0f, depthDistribution(random) };
+			glm::vec3 extent{ sizeDistribution(random), sizeDistribution(random) * 4.0f, sizeDistribution(random) };
+			occluder = OcclusionMesh::CreateBox(AABB{ center - extent, center + extent });
+		}
+
+		std::vector<AABB> objects(objectCount);
+		for (auto& object : objects)
+		{
+			glm::vec3 center{ positionDistribution(random), positionDistribution(random) * 0.1f, depthDistribution(random) };
+			glm::vec3 extent{ 0.5f };
+			object = AABB{ center - extent, center + extent };
+		}
+
+		Camera camera{};
+		camera.setPerspectiveProjection(glm::radians(50.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+		camera.setViewYXZ(glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f));
+		glm::mat4 viewProjection = camera.getProjectionMatrix() * camera.getViewMatrix();
+
+		std::printf("%u occluders, %u objects, %u repetitions\n", occluderCount, objectCount, repetitions);
+
+		OcclusionCuller culler;
+		auto rasterize = [&](ThreadPool* threadPool)
+		{
+			culler.beginFrame(viewProjection);
+			for (const auto& occluder : occluders)
+			{
+				culler.addOccluder(occluder, glm::mat4{ 1.0f });
+			}
+			culler.rasterize(threadPool);
+		};
+
+		BenchmarkResult singleThreaded = RunBenchmark("Rasterize (1 thread)", repetitions, [&]() { rasterize(nullptr); });
+		PrintBenchmarkResult(singleThreaded);
+
+		ThreadPool threadPool;
+		BenchmarkResult multiThreaded = RunBenchmark("Rasterize (thread pool)", repetitions, [&]() { rasterize(&threadPool); });
+		PrintBenchmarkResult(multiThreaded, &singleThreaded);
+		std::printf("  %u threads, %u triangles\n", threadPool.getThreadCount(), culler.getStats().triangleCount);
+
+		uint32_t occludedCount = 0;
+		BenchmarkResult test = RunBenchmark("Test objects", repetitions, [&]()
+		{
+			occludedCount = 0;
+			for (const auto& object : objects)
+			{
+				occludedCount += culler.isOccluded(object) ? 1 : 0;
+			}
+		});
+		PrintBenchmarkResult(test);
+		std::printf("  %u of %u objects occluded\n\n", occludedCount, objectCount);
+	}
+}
+
+void RunOcclusionBenchmarks()
+{
+	std::printf("=== Occlusion culling (%s) ===\n", SIMD_SSE2 ? "SSE2" : "scalar");
+
+	RunOcclusionBenchmark(100, 10000, 50);
+	RunOcclusionBenchmark(1000, 100000, 20);
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "Benchmark.h"
+
+#include "Registry.h"
+#include "TransformSystem.h"
+
+#include <memory>
+#include <random>
+
+namespace
+{
+	// What every object used to look like: one record with a reference counted model, a color and the full transform
+	struct LegacyGameObject
+	{
+		std::shared_ptr<int> model;
+		glm::vec3 color{};
+		TransformComponent transform{};
+	};
+
+	struct BenchmarkTransform
+	{
+		uint32_t transformId;
+	};
+
+	struct BenchmarkMesh
+	{
+		const int* model;
+	};
+
+	struct BenchmarkVelocity
+	{
+		glm::vec3 velocity;
+	};
+
+	void RunRegistryBenchmark(uint32_t entityCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		auto sharedModel = std::make_shared<int>(1);
+
+		std::printf("%u entities, %u repetitions\n", entityCount, repetitions);
+
+		std::vector<LegacyGameObject> gameObjects;
+		BenchmarkResult legacyCreate = RunBenchmark("Create std::vector<GameObject>", repetitions, [&]()
+		{
+			gameObjects.clear();
+			gameObjects.shrink_to_fit();
+			for (uint32_t i = 0; i < entityCount; i++)
+			{
+				LegacyGameObject gameObject{};
+				gameObject.model = sharedModel;
+				gameObjects.push_back(std::move(gameObject));
+			}
+		});
+		PrintBenchmarkResult(legacyCreate);
+
+		std::unique_ptr<Registry> registry;
+		std::vector<Entity> entities(entityCount);
+		BenchmarkResult registryCreate = RunBenchmark("Create Registry", repetitions, [&]()
+		{
+			registry = std::make_unique<Registry>();
+			for (uint32_t i = 0; i < entityCount; i++)
+			{
+				entities[i] = registry->create();
+				registry->add<BenchmarkTransform>(entities[i], i);
+				registry->add<BenchmarkMesh>(entities[i], sharedModel.get());
+
+				// Only a quarter of the entities moves
+				if (i % 4 == 0)
+				{
+					registry->add<BenchmarkVelocity>(entities[i], glm::vec3(distribution(random)));
+				}
+			}
+		});
+		PrintBenchmarkResult(registryCreate, &legacyCreate);
+
+		// Render like iteration: every drawable needs its model and the id of its transform
+		uint64_t checksum = 0;
+		BenchmarkResult legacyIterate = RunBenchmark("Iterate GameObjects (model)", repetitions, [&]()
+		{
+			for (auto& gameObject : gameObjects)
+			{
+				checksum += *gameObject.model;
+			}
+			DoNotOptimize(checksum);
+		});
+		PrintBenchmarkResult(legacyIterate);
+
+		BenchmarkResult singleIterate = RunBenchmark("each<Mesh>", repetitions, [&]()
+		{
+			registry->each<BenchmarkMesh>([&](Entity, BenchmarkMesh& mesh)
+			{
+				checksum += *mesh.model;
+			});
+			DoNotOptimize(checksum);
+		});
+		PrintBenchmarkResult(singleIterate, &legacyIterate);
+
+		BenchmarkResult pairIterate = RunBenchmark("each<Mesh, Transform>", repetitions, [&]()
+		{
+			registry->each<BenchmarkMesh, BenchmarkTransform>([&](Entity, BenchmarkMesh& mesh, BenchmarkTransform& transform)
+			{
+				checksum += *mesh.model + transform.transformId;
+			});
+			DoNotOptimize(checksum);
+		});
+		PrintBenchmarkResult(pairIterate, &legacyIterate);
+
+		// Sparse iteration: only the moving entities, driven by the smallest pool
+		BenchmarkResult sparseIterate = RunBenchmark("each<Velocity, Transform> (1/4)", repetitions, [&]()
+		{
+			registry->each<BenchmarkVelocity, BenchmarkTransform>([&](Entity, BenchmarkVelocity& velocity, BenchmarkTransform& transform)
+			{
+				checksum += transform.transformId + static_cast<uint64_t>(velocity.velocity.x > 0.0f);
+			});
+			DoNotOptimize(checksum);
+		});
+		PrintBenchmarkResult(sparseIterate, &legacyIterate);
+
+		std::shuffle(entities.begin(), entities.end(), random);
+		BenchmarkResult randomLookup = RunBenchmark("Random get<Transform>", repetitions, [&]()
+		{
+			ComponentPool<BenchmarkTransform>& transforms = registry->getPool<BenchmarkTransform>();
+			for (Entity entity : entities)
+			{
+				checksum += transforms.get(entity).transformId;
+			}
+			DoNotOptimize(checksum);
+		});
+		PrintBenchmarkResult(randomLookup, &legacyIterate);
+
+		std::printf("\n");
+	}
+
+	// The transform lives in the transform system, so destroying an entity has to hand it back as well
+	Entity CreateEntity(Registry& registry, TransformSystem& transformSystem)
+	{
+		Entity entity = registry.create();
+		registry.add<BenchmarkTransform>(entity, transformSystem.createTransform());
+
+		return entity;
+	}
+
+	void DestroyEntity(Registry& registry, TransformSystem& transformSystem, Entity entity)
+	{
+		transformSystem.destroyTransform(registry.get<BenchmarkTransform>(entity).transformId);
+		registry.destroy(entity);
+	}
+
+	// Entities that keep getting destroyed and created (like projectiles) should reuse the transforms of the
+	// destroyed ones instead of growing the transform system every frame
+	void RunEntityChurnBenchmark(uint32_t entityCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+
+		Registry registry;
+		TransformSystem transformSystem;
+		std::vector<Entity> entities(entityCount);
+		for (Entity& entity : entities)
+		{
+			entity = CreateEntity(registry, transformSystem);
+		}
+
+		// Some of the transforms are children, so destroying also has to detach them
+		for (uint32_t i = 1; i < entityCount; i += 4)
+		{
+			transformSystem.setParent(registry.get<BenchmarkTransform>(entities[i]).transformId, registry.get<BenchmarkTransform>(entities[i - 1]).transformId);
+		}
+		transformSystem.update();
+
+		std::printf("%u entities, %u repetitions\n", entityCount, repetitions);
+
+		uint32_t churnCount = entityCount / 10;
+		BenchmarkResult churn = RunBenchmark("Destroy + create 10% and update", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < churnCount; i++)
+			{
+				Entity& entity = entities[random() % entityCount];
+				DestroyEntity(registry, transformSystem, entity);
+				entity = CreateEntity(registry, transformSystem);
+			}
+
+			transformSystem.update();
+		});
+		PrintBenchmarkResult(churn);
+		PrintThroughput(churn, churnCount, "entities");
+
+		std::printf("  %zu transforms for %zu entities (%s)\n\n", transformSystem.size(), registry.size(),
+			transformSystem.size() == registry.size() ? "destroyed transforms reused" : "LEAKING TRANSFORMS");
+	}
+}
+
+void RunRegistryBenchmarks()
+{
+	std::printf("=== Entity component storage ===\n");
+
+	RunRegistryBenchmark(10000, 100);
+	RunRegistryBenchmark(1000000, 10);
+
+	RunEntityChurnBenchmark(10000, 100);
+	RunEntityChurnBenchmark(100000, 20);
+}
\ No newline at end of file
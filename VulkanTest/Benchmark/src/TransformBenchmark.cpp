@@ -0,0 +1,158 @@
+#include "Benchmark.h"
+
+#include "TransformSystem.h"
+#include "Simd.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+	// Same layout as the per-object data the renderer uploads
+	struct ObjectData
+	{
+		glm::mat4 modelMatrix;
+		glm::mat4 normalMatrix;
+	};
+
+	float MaxDifference(const std::vector<glm::mat4>& a, const std::vector<ObjectData>& b, bool normal)
+	{
+		float maxDifference = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			const glm::mat4& other = normal ? b[i].normalMatrix : b[i].modelMatrix;
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					maxDifference = std::max(maxDifference, std::abs(a[i][column][row] - other[column][row]));
+				}
+			}
+		}
+
+		return maxDifference;
+	}
+
+	void RunTransformBenchmark(uint32_t objectCount, uint32_t repetitions)
+	{
+		std::mt19937 random(BENCHMARK_SEED);
+		std::uniform_real_distribution<float> translationDistribution(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> rotationDistribution(-glm::two_pi<float>(), glm::two_pi<float>());
+		std::uniform_real_distribution<float> scaleDistribution(0.1f, 4.0f);
+
+		// Per-object path: array of TransformComponents, both matrices computed separately for every object
+		std::vector<TransformComponent> components(objectCount);
+		TransformSystem transformSystem;
+		for (auto& component : components)
+		{
+			component.translation = { translationDistribution(random), translationDistribution(random), translationDistribution(random) };
+			component.rotation = { rotationDistribution(random), rotationDistribution(random), rotationDistribution(random) };
+			component.scale = { scaleDistribution(random), scaleDistribution(random), scaleDistribution(random) };
+
+			transformSystem.createTransform(component);
+		}
+
+		std::vector<ObjectData> objectData(objectCount);
+
+		// Batched paths over the structure-of-arrays data of the transform system
+		std::vector<float> translationX(objectCount), translationY(objectCount), translationZ(objectCount);
+		std::vector<float> rotationX(objectCount), rotationY(objectCount), rotationZ(objectCount);
+		std::vector<float> scaleX(objectCount), scaleY(objectCount), scaleZ(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			translationX[i] = components[i].translation.x;
+			translationY[i] = components[i].translation.y;
+			translationZ[i] = components[i].translation.z;
+			rotationX[i] = components[i].rotation.x;
+			rotationY[i] = components[i].rotation.y;
+			rotationZ[i] = components[i].rotation.z;
+			scaleX[i] = components[i].scale.x;
+			scaleY[i] = components[i].scale.y;
+			scaleZ[i] = components[i].scale.z;
+		}
+
+		TransformSystem::TransformArrays arrays
+		{
+			translationX.data(), translationY.data(), translationZ.data(),
+			rotationX.data(), rotationY.data(), rotationZ.data(),
+			scaleX.data(), scaleY.data(), scaleZ.data()
+		};
+
+		std::vector<glm::mat4> scalarModel(objectCount), scalarNormal(objectCount);
+		std::vector<glm::mat4> simdModel(objectCount), simdNormal(objectCount);
+
+		std::printf("%u objects, %u repetitions\n", objectCount, repetitions);
+
+		BenchmarkResult perObject = RunBenchmark("Per object (TransformComponent)", repetitions, [&]()
+		{
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				objectData[i].modelMatrix = components[i].getTransformationMatrix();
+				objectData[i].normalMatrix = components[i].getNormalMatrix();
+			}
+			DoNotOptimize(objectData);
+		});
+		PrintBenchmarkResult(perObject);
+		PrintThroughput(perObject, objectCount, "objects");
+
+		BenchmarkResult scalar = RunBenchmark("Batched scalar", repetitions, [&]()
+		{
+			TransformSystem::ComputeMatricesScalar(arrays, objectCount, scalarModel.data(), scalarNormal.data());
+			DoNotOptimize(scalarModel);
+		});
+		PrintBenchmarkResult(scalar, &perObject);
+
+		BenchmarkResult simd = RunBenchmark(SIMD_SSE2 ? "Batched SIMD (SSE2)" : "Batched SIMD (scalar fallback)", repetitions, [&]()
+		{
+			TransformSystem::ComputeMatrices(arrays, objectCount, simdModel.data(), simdNormal.data());
+			DoNotOptimize(simdModel);
+		});
+		PrintBenchmarkResult(simd, &perObject);
+
+		// Only a fraction of the objects moves every frame, the rest is static and should cost nothing
+		for (uint32_t movingPercentage : { 100u, 10u, 1u, 0u })
+		{
+			uint32_t movingCount = objectCount * movingPercentage / 100;
+			uint32_t step = movingCount > 0 ? objectCount / movingCount : 0;
+			float offset = 0.0f;
+
+			char name[64];
+			std::snprintf(name, sizeof(name), "TransformSystem::update %3u%% moving", movingPercentage);
+
+			BenchmarkResult system = RunBenchmark(name, repetitions, [&]()
+			{
+				offset += 0.001f;
+				for (uint32_t i = 0; i < movingCount; i++)
+				{
+					TransformSystem::id_t id = i * step;
+					transformSystem.setTranslation(id, components[id].translation + offset);
+				}
+
+				transformSystem.update();
+			});
+			PrintBenchmarkResult(system, &perObject);
+
+			// The kernel is the lower bound, everything above it is bookkeeping and memory traffic of the system
+			if (movingPercentage == 100)
+			{
+				std::printf("  %-36s %9.2fx the SIMD kernel time\n", "", system.medianMs / simd.medianMs);
+			}
+		}
+
+		std::printf("  Max difference to per object path: scalar model %g normal %g, SIMD model %g normal %g\n\n",
+			MaxDifference(scalarModel, objectData, false), MaxDifference(scalarNormal, objectData, true),
+			MaxDifference(simdModel, objectData, false), MaxDifference(simdNormal, objectData, true));
+	}
+}
+
+void RunTransformBenchmarks()
+{
+	std::printf("=== Transform matrices ===\n");
+
+	RunTransformBenchmark(1000, 200);
+	RunTransformBenchmark(10000, 100);
+	RunTransformBenchmark(100000, 20);
+	RunTransformBenchmark(1000000, 5);
+}
\ No newline at end of file
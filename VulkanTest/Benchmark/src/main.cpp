@@ -0,0 +1,13 @@
+#include "Benchmark.h"
+
+int main()
+{
+	RunTransformBenchmarks();
+	RunRegistryBenchmarks();
+	RunBvhBenchmarks();
+	RunOcclusionBenchmarks();
+	RunModelBenchmarks();
+	RunCameraBenchmarks();
+
+	return 0;
+}
\ No newline at end of file
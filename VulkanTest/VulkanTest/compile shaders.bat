@@ -1,3 +1,7 @@
 C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\simple.vert -o shaders\simple.vert.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\simple_push.vert -o shaders\simple_push.vert.spv
 C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\simple.frag -o shaders\simple.frag.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\depth_prepass.vert -o shaders\depth_prepass.vert.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\cull.comp -o shaders\cull.comp.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shaders\depth_reduce.comp -o shaders\depth_reduce.comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 450
+
+// Only the position stream of the model is bound
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	vec3 lightDirection;
+} ubo;
+
+struct ObjectData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+} objectBuffer;
+
+layout(push_constant) uniform Push 
+{
+	uint objectIndex;
+} push;
+
+// The color pass tests against this depth, so both have to compute exactly the same position
+invariant gl_Position;
+
+void main()
+{
+	ObjectData object = objectBuffer.objects[push.objectIndex + gl_InstanceIndex];
+
+	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * object.modelMatrix * vec4(position, 1.0);
+}
\ No newline at end of file
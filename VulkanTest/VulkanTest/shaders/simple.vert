@@ -14,20 +14,37 @@ layout(set = 0, binding = 0) uniform GlobalUbo
 	vec3 lightDirection;
 } ubo;
 
-layout(push_constant) uniform Push 
+struct ObjectData
 {
 	mat4 modelMatrix;
 	mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+} objectBuffer;
+
+layout(push_constant) uniform Push 
+{
+	uint objectIndex;
 } push;
 
-const float AMBIENT = 0.02;
+// Has to match the depth written by depth_prepass.vert
+invariant gl_Position;
+
+// Set by the pipeline, see SimpleRenderSystem::AMBIENT
+layout(constant_id = 0) const float AMBIENT = 0.02;
 
 void main()
 {
-	vec3 worldNormal = normalize(mat3(push.normalMatrix) * normal);
+	// The pushed index is the first object of the draw, instanced draws continue from there
+	ObjectData object = objectBuffer.objects[push.objectIndex + gl_InstanceIndex];
+
+	vec3 worldNormal = normalize(mat3(object.normalMatrix) * normal);
 	float lightIntensity = max(dot(worldNormal, ubo.lightDirection), 0) + AMBIENT;
 
 	fragColor = lightIntensity * color;
 
-	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * push.modelMatrix * vec4(position, 1.0);
+	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * object.modelMatrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	vec3 lightDirection;
+} ubo;
+
+// The transforms of the object are pushed with every draw instead of read from the object buffer, only used to
+// compare both ways (Vulkan only guarantees 128 bytes of push constants, so this is all that fits)
+layout(push_constant) uniform Push 
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+} push;
+
+// Set by the pipeline, see SimpleRenderSystem::AMBIENT
+layout(constant_id = 0) const float AMBIENT = 0.02;
+
+void main()
+{
+	vec3 worldNormal = normalize(mat3(push.normalMatrix) * normal);
+	float lightIntensity = max(dot(worldNormal, ubo.lightDirection), 0) + AMBIENT;
+
+	fragColor = lightIntensity * color;
+
+	gl_Position = ubo.projectionMatrix * ubo.viewMatrix * push.modelMatrix * vec4(position, 1.0);
+}
\ No newline at end of file
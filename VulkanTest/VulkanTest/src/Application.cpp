@@ -1,12 +1,19 @@
 #include "Application.h"
+#include "CpuProfiler.h"
 #include "SimpleRenderSystem.h"
 #include "Camera.h"
 #include "KeyBoardMovementController.h"
-#include "Buffer.h"
+#include "FrameAllocator.h"
+#include "PipelineCache.h"
+#include "CameraPath.h"
 
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <chrono>
+#include <fstream>
+#include <iostream>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -20,75 +27,167 @@ struct GlobalUbo
 	alignas(16) glm::vec3 lightDirection = glm::normalize(glm::vec3{ 1.0f, -3.0f, -1.0f });
 };
 
-Application::Application()
+Application::Application(const Settings& settings): m_settings(settings)
 {
 	m_globalPool = DescriptorPool::Builder(m_device)
-		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.setMaxSets(m_renderer.getFramesInFlight())
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_renderer.getFramesInFlight())
 		.build();
 
-	loadGameObjects();
+	if (m_settings.multithreadedRecording)
+	{
+		uint32_t threadCount = m_settings.recordingThreadCount > 0 ? m_settings.recordingThreadCount : std::thread::hardware_concurrency();
+		m_recordingThreads = std::make_unique<ThreadPool>(threadCount);
+		m_renderer.setRecordingThreadPool(m_recordingThreads.get());
+
+		// The transforms are updated before recording starts, so the same workers can be reused for that
+		m_transformSystem.setThreadPool(m_recordingThreads.get());
+	}
+
+	// Created before loading, so the uploads are timed as well. The benchmark always times the GPU when it can
+	if (m_settings.gpuProfiling || !m_settings.benchmarkFile.empty())
+	{
+		m_gpuProfiler = std::make_unique<GpuProfiler>(m_device, m_renderer.getFramesInFlight());
+		m_gpuProfiler->setKeepAllSamples(!m_settings.benchmarkFile.empty());
+		m_device.setGpuProfiler(m_gpuProfiler.get());
+	}
+
+	if (m_settings.sceneObjectCount > 0)
+	{
+		loadBenchmarkScene();
+	}
+	else
+	{
+		loadEntities();
+	}
 }
 
 Application::~Application()
 {
-
+	m_renderer.setRecordingThreadPool(nullptr);
+	m_device.setGpuProfiler(nullptr);
 }
 
 void Application::run()
 {
-	// Double buffering (use a buffer for every possible frame (so we don't have to wait for a frame to finish rendering, 
-	// and therefore finish using the ubo) and just write data to the ubo that is going to be used next)
-	std::vector<std::unique_ptr<Buffer>> uboBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	for (int i = 0; i < uboBuffers.size(); i++)
-	{
-		uboBuffers[i] = std::make_unique<Buffer>
-		(
-			m_device,
-			sizeof(GlobalUbo),
-			1,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-		);
-
-		uboBuffers[i]->map();
-	}
+	// Every frame in flight allocates its uniforms from its own buffer (so we don't have to wait for a frame to finish
+	// rendering, and therefore finish using them), bound with a dynamic offset into the frame's descriptor set
+	FrameAllocator frameAllocator{ m_device, m_renderer.getFramesInFlight() };
 
 	auto globalSetLayout = DescriptorSetLayout::Builder(m_device)
-		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
 		.build();
 
-	std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	std::vector<VkDescriptorSet> globalDescriptorSets(m_renderer.getFramesInFlight());
 	for (int i = 0; i < globalDescriptorSets.size(); i++)
 	{
-		auto bufferInfo = uboBuffers[i]->descriptorInfo();
+		auto bufferInfo = frameAllocator.descriptorInfo(i, sizeof(GlobalUbo));
 
 		DescriptorWriter(*globalSetLayout, *m_globalPool)
 			.writeBuffer(0, &bufferInfo)
 			.build(globalDescriptorSets[i]);
 	}
 
-	SimpleRenderSystem simpleRenderSystem{ m_device, m_renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+	// Render systems get their pipelines (and variants of them) from here, so pipelines that are the same are shared
+	PipelineCache pipelineCache{ m_device };
+
+	// Every transform (including the one of the viewer) can be an object index
+	uint32_t maxObjects = std::max(SimpleRenderSystem::DEFAULT_MAX_OBJECTS, m_settings.sceneObjectCount + 1);
+	SimpleRenderSystem::TransformSource transformSource = m_settings.pushConstantTransforms ? SimpleRenderSystem::TransformSource::PushConstants : SimpleRenderSystem::TransformSource::StorageBuffer;
+	SimpleRenderSystem simpleRenderSystem{ m_device, pipelineCache, m_renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout(), m_renderer.getFramesInFlight(), maxObjects, transformSource };
+	simpleRenderSystem.setOcclusionCulling(m_settings.occlusionCulling, m_recordingThreads.get());
+	simpleRenderSystem.setGpuOcclusionCulling(m_settings.gpuOcclusionCulling);
+	simpleRenderSystem.setDepthPrepass(m_settings.depthPrepass, m_renderer.getSwapChainDepthPrepassRenderPass());
+	simpleRenderSystem.setCullMode(m_settings.backfaceCulling ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE);
 
 	Camera camera{};
 	//camera.setViewDirection(glm::vec3(0.0f), glm::vec3(0.5f, 0.0f, 1.0f));
 	//camera.setViewTarget(glm::vec3(-1.0f, -2.0f, 20.0f), glm::vec3(0.0f, 0.0f, 2.5f));
 
-	auto viewerObject = GameObject::CreateGameObject();
+	Entity viewer = createEntity();
+	m_registry.add<KeyboardControlComponent>(viewer);
+	TransformSystem::id_t viewerTransform = m_registry.get<TransformHandleComponent>(viewer).transformId;
+
 	KeyboardMovementController cameraController{};
 
+	CameraPath cameraRecording{};
+	CameraPath cameraPlayback{};
+	bool playing = !m_settings.cameraPlaybackFile.empty();
+	if (playing)
+	{
+		cameraPlayback = CameraPath::LoadFromFile(m_settings.cameraPlaybackFile);
+	}
+
+	// A path is the same series of views at any frame rate, so it plays with a fixed timestep as well
+	float fixedTimestep = m_settings.fixedTimestep;
+	if (playing && fixedTimestep <= 0.0f)
+	{
+		fixedTimestep = CameraPath::DEFAULT_TIMESTEP;
+	}
+	uint32_t loopFrameCount = 0;
+	uint32_t swapChainVersion = m_renderer.getSwapChainVersion();
+
 	auto currentTime = std::chrono::high_resolution_clock::now();
+	float statsTimer = 0.0f;
+	uint32_t statsFrameCount = 0;
+	uint32_t renderedFrameCount = 0;
+	std::vector<double> cpuFrameTimesMs;
 
-	while (!m_window.shouldClose())
+	if (!m_settings.cpuProfileFile.empty())
 	{
+#ifdef CPU_PROFILING
+		CpuProfiler::Get().requestCapture(m_settings.cpuProfileFile, m_settings.cpuProfileFrameCount);
+#else
+		std::cerr << "Cpu profiling is not available, build with CPU_PROFILING defined" << std::endl;
+#endif
+	}
+
+	while (!m_window.shouldClose() && (m_settings.frameCount == 0 || renderedFrameCount < m_settings.frameCount))
+	{
+		if (playing && loopFrameCount >= cameraPlayback.getFrameCount())
+		{
+			break;
+		}
+
+		PROFILE_FRAME();
+		PROFILE_ZONE("Frame");
+
 		m_window.update();
+		// Between frames, so a pipeline that finished compiling is used for the whole frame
+		pipelineCache.update();
+
+		// The render passes of a recreated swap chain replace the old ones, which are destroyed once the frames that
+		// used them are done (at the earliest in the next beginFrame)
+		if (swapChainVersion != m_renderer.getSwapChainVersion())
+		{
+			swapChainVersion = m_renderer.getSwapChainVersion();
+			simpleRenderSystem.setRenderPasses(m_renderer.getSwapChainRenderPass(), m_renderer.getSwapChainDepthPrepassRenderPass());
+		}
 		
 		auto newTime = std::chrono::high_resolution_clock::now();
 		float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 		currentTime = newTime;
 
-		cameraController.moveInPlaneXZ(m_window.getNativeWindow(), frameTime, viewerObject);
-		camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+		// The measured frame time is still what the stats and the benchmark report
+		float deltaTime = fixedTimestep > 0.0f ? fixedTimestep : frameTime;
+
+		if (playing)
+		{
+			const CameraPath::Frame& frame = cameraPlayback.getFrame(loopFrameCount);
+			m_transformSystem.setTranslation(viewerTransform, frame.translation);
+			m_transformSystem.setRotation(viewerTransform, frame.rotation);
+		}
+		else if (!m_window.isHeadless())
+		{
+			cameraController.moveInPlaneXZ(m_window.getNativeWindow(), deltaTime, m_registry, m_transformSystem);
+		}
+		loopFrameCount++;
+
+		if (!m_settings.cameraRecordFile.empty())
+		{
+			cameraRecording.addFrame(m_transformSystem.getTranslation(viewerTransform), m_transformSystem.getRotation(viewerTransform));
+		}
+		camera.setViewYXZ(m_transformSystem.getTranslation(viewerTransform), m_transformSystem.getRotation(viewerTransform));
 
 		float aspect = m_renderer.getAspectRatio();
 		camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
@@ -98,42 +197,280 @@ void Application::run()
 		{
 			int frameIndex = m_renderer.getFrameIndex();
 
+			// The frame is done on the GPU, so everything it allocated can be reused
+			frameAllocator.reset(frameIndex);
+			if (m_gpuProfiler != nullptr)
+			{
+				m_gpuProfiler->beginFrame(commandBuffer, frameIndex);
+			}
+			std::unique_ptr<GpuProfiler::Scope> frameScope = std::make_unique<GpuProfiler::Scope>(m_gpuProfiler.get(), commandBuffer, "Frame");
+
+			// Update
+			GlobalUbo ubo{};
+			ubo.projectionMatrix = camera.getProjectionMatrix();
+			ubo.viewMatrix = camera.getViewMatrix();
+			uint32_t globalUboOffset = frameAllocator.push(frameIndex, ubo);
+
 			FrameInfo frameInfo
 			{
 				frameIndex,
-				frameTime,
+				deltaTime,
 				commandBuffer,
 				camera,
-				globalDescriptorSets[frameIndex]
+				globalDescriptorSets[frameIndex],
+				globalUboOffset,
+				m_renderer,
+				frameAllocator
 			};
 
-			// Update
-			GlobalUbo ubo{};
-			ubo.projectionMatrix = camera.getProjectionMatrix();
-			ubo.viewMatrix = camera.getViewMatrix();
-			uboBuffers[frameIndex]->writeToBuffer(&ubo);
-			uboBuffers[frameIndex]->flush();
+			m_transformSystem.update();
+			m_spatialIndex.update(m_registry, m_transformSystem);
+			simpleRenderSystem.prepareEntities(frameInfo, m_registry, m_transformSystem, m_spatialIndex);
+
+			// Render, the GPU timings are taken outside of the render passes (which might only execute secondary
+			// command buffers), so the main pass includes the depth pre-pass
+			{
+				GpuProfiler::Scope scope{ m_gpuProfiler.get(), commandBuffer, "Main pass" };
+
+				if (simpleRenderSystem.isDepthPrepassEnabled())
+				{
+					m_renderer.beginSwapChainRenderPass(commandBuffer, Renderer::RenderPassMode::DepthPrepass);
+					simpleRenderSystem.renderEntityDepth(frameInfo, m_transformSystem);
+					m_renderer.nextSwapChainSubpass(commandBuffer);
+				}
+				else
+				{
+					m_renderer.beginSwapChainRenderPass(commandBuffer);
+				}
+				simpleRenderSystem.renderEntities(frameInfo, m_transformSystem);
+				m_renderer.endSwapChainRenderPass(commandBuffer);
+			}
 
-			// Render
-			m_renderer.beginSwapChainRenderPass(commandBuffer);
-			simpleRenderSystem.renderGameObjects(frameInfo, m_gameObjects);
-			m_renderer.endSwapChainRenderPass(commandBuffer);
+			// The objects that were hidden last frame but aren't behind what got drawn now are drawn in a second pass
+			if (simpleRenderSystem.isGpuOcclusionCullingEnabled())
+			{
+				{
+					GpuProfiler::Scope scope{ m_gpuProfiler.get(), commandBuffer, "Occlusion culling" };
+					simpleRenderSystem.cullOccludedEntities(frameInfo);
+				}
+
+				GpuProfiler::Scope scope{ m_gpuProfiler.get(), commandBuffer, "Late pass" };
+				m_renderer.beginSwapChainRenderPass(commandBuffer, Renderer::RenderPassMode::Load);
+				simpleRenderSystem.renderNewlyVisibleEntities(frameInfo);
+				m_renderer.endSwapChainRenderPass(commandBuffer);
+			}
+
+			frameScope = nullptr;
+			frameAllocator.flush(frameIndex);
 			m_renderer.endFrame();
+			renderedFrameCount++;
+
+			// The time between two frames, which includes waiting for the GPU when it is the bottleneck
+			if (!m_settings.benchmarkFile.empty() && renderedFrameCount > m_settings.benchmarkWarmupFrameCount)
+			{
+				cpuFrameTimesMs.push_back(1000.0 * frameTime);
+			}
+
+			// The stats are per frame, printing them every frame would only slow it down
+			statsTimer += frameTime;
+			statsFrameCount++;
+			if (statsTimer >= 1.0f)
+			{
+				if (m_settings.frameStats)
+				{
+					Renderer::LatencyStats latency = m_renderer.takeLatencyStats();
+					Renderer::CommandPoolStats commandPools = m_renderer.takeCommandPoolStats();
+					Renderer::RecordingStats recording = m_renderer.takeRecordingStats();
+					std::cout << "Frames in flight " << m_renderer.getFramesInFlight() << ": " << 1000.0f * statsTimer / statsFrameCount
+						<< "ms frame time, " << latency.getAverageMs() << "ms latency (max " << latency.maxMs << "ms), "
+						<< commandPools.getAverageMs() << "ms command pool overhead, " << recording.getAverageMs() << "ms recording "
+						<< recording.itemCount / std::max(recording.frameCount, 1u) << " items on " << m_renderer.getRecordingThreadCount()
+						<< " threads" << std::endl;
+				}
+
+				if (m_gpuProfiler != nullptr)
+				{
+					for (const GpuProfiler::PassStats& pass : m_gpuProfiler->getPassStats())
+					{
+						std::cout << "GPU " << pass.name << ": " << pass.getAverageMs() << "ms (max " << pass.maxMs << "ms)" << std::endl;
+					}
+				}
+
+				if (simpleRenderSystem.isOcclusionCullingEnabled())
+				{
+					const OcclusionCuller::Stats& stats = simpleRenderSystem.getOcclusionStats();
+					std::cout << "Occlusion: " << stats.occludedCount << "/" << stats.testedCount << " occluded, "
+						<< stats.occluderCount << " occluders (" << stats.triangleCount << " triangles) rasterized in "
+						<< stats.rasterizeTimeMs << "ms" << std::endl;
+				}
+
+				statsTimer = 0.0f;
+				statsFrameCount = 0;
+			}
 		}
 	}
 
 	vkDeviceWaitIdle(m_device.device());
+
+	if (m_gpuProfiler != nullptr && !m_settings.gpuProfileFile.empty())
+	{
+		std::ofstream file{ m_settings.gpuProfileFile };
+		const std::string& name = m_settings.gpuProfileFile;
+		if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+		{
+			m_gpuProfiler->writeJson(file);
+		}
+		else
+		{
+			m_gpuProfiler->writeCsv(file);
+		}
+	}
+
+	if (!m_settings.benchmarkFile.empty())
+	{
+		writeBenchmarkReport(cpuFrameTimesMs);
+	}
+
+	if (m_settings.frameStats)
+	{
+		const PipelineCache::Stats& stats = pipelineCache.getStats();
+		std::cout << "Pipeline cache: " << pipelineCache.getPipelineCount() << " pipelines, " << stats.hitCount << " hits, "
+			<< stats.missCount << " misses, " << stats.createTimeMs << " ms creating pipelines, " << stats.asyncCompileCount
+			<< " compiled in the background in " << stats.asyncCompileTimeMs << " ms, " << stats.fallbackCount << " fallbacks ("
+			<< stats.skippedCount << " skipped)" << std::endl;
+	}
+
+	if (!m_settings.cameraRecordFile.empty())
+	{
+		cameraRecording.saveToFile(m_settings.cameraRecordFile);
+		std::cout << "Recorded " << cameraRecording.getFrameCount() << " camera frames to " << m_settings.cameraRecordFile << std::endl;
+	}
+}
+
+void Application::loadEntities()
+{
+	m_models.push_back(Model::CreateModelFromFile(m_device, "res/flat_vase.obj"));
+	Model* model = m_models.back().get();
+
+	TransformComponent transform{};
+	transform.translation = { 0.0f, 0.5f, 2.5f };
+	transform.rotation = { 0, 0, 0 };
+	transform.scale = { 0.5f, 0.5f, 0.5f };
+
+	Entity vase = createEntity(transform);
+	m_registry.add<MeshComponent>(vase, model);
+
+	// Occluders have to stay inside of what they hide, so the vase only occludes with a box half the size of its bounds
+	const AABB& bounds = model->getBounds();
+	AABB occluderBounds{ bounds.getCenter() - bounds.getExtent() * 0.5f, bounds.getCenter() + bounds.getExtent() * 0.5f };
+
+	m_occlusionMeshes.push_back(std::make_unique<OcclusionMesh>(OcclusionMesh::CreateBox(occluderBounds)));
+	m_registry.add<OccluderComponent>(vase, m_occlusionMeshes.back().get());
+}
+
+void Application::loadBenchmarkScene()
+{
+	// Every model has more detail than the one before it, so the models really are distinct
+	for (uint32_t i = 0; i < m_settings.sceneModelCount; i++)
+	{
+		Model::Data data{};
+		data.generateSphere(8 + 4 * i, 4 + 2 * i);
+		m_models.push_back(std::make_unique<Model>(m_device, data));
+	}
+
+	// A cube of objects in front of the camera, far enough apart not to overlap
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(m_settings.sceneObjectCount))));
+	const float spacing = 1.2f;
+
+	for (uint32_t i = 0; i < m_settings.sceneObjectCount; i++)
+	{
+		uint32_t x = i % side;
+		uint32_t y = (i / side) % side;
+		uint32_t z = i / (side * side);
+
+		TransformComponent transform{};
+		transform.translation = { (x - side * 0.5f) * spacing, (y - side * 0.5f) * spacing, 3.0f + z * spacing };
+		transform.rotation = { 0.0f, 0.0f, 0.0f };
+		transform.scale = { 1.0f, 1.0f, 1.0f };
+
+		Entity entity = createEntity(transform);
+		m_registry.add<MeshComponent>(entity, m_models[i % m_models.size()].get());
+	}
+}
+
+static double Percentile(const std::vector<double>& sortedValues, double percentile)
+{
+	if (sortedValues.empty())
+	{
+		return 0.0;
+	}
+
+	size_t index = static_cast<size_t>(percentile / 100.0 * (sortedValues.size() - 1) + 0.5);
+	return sortedValues[index];
 }
 
-void Application::loadGameObjects()
+static void WriteTimingsJson(std::ostream& stream, std::vector<double> timesMs)
 {
-	std::shared_ptr<Model> model = Model::CreateModelFromFile(m_device, "res/flat_vase.obj");
+	std::sort(timesMs.begin(), timesMs.end());
 
-	auto cube = GameObject::CreateGameObject();
-	cube.model = model;
-	cube.transform.translation = { 0.0f, 0.5f, 2.5f };
-	cube.transform.rotation = { 0, 0, 0 };
-	cube.transform.scale = { 0.5f, 0.5f, 0.5f };
+	double totalMs = 0.0;
+	for (double ms : timesMs)
+	{
+		totalMs += ms;
+	}
 
-	m_gameObjects.push_back(std::move(cube));
+	stream << "{ \"samples\": " << timesMs.size()
+		<< ", \"averageMs\": " << (timesMs.empty() ? 0.0 : totalMs / timesMs.size())
+		<< ", \"p50Ms\": " << Percentile(timesMs, 50.0)
+		<< ", \"p95Ms\": " << Percentile(timesMs, 95.0)
+		<< ", \"p99Ms\": " << Percentile(timesMs, 99.0)
+		<< ", \"maxMs\": " << (timesMs.empty() ? 0.0 : timesMs.back()) << " }";
 }
+
+void Application::writeBenchmarkReport(const std::vector<double>& cpuFrameTimesMs)
+{
+	std::ofstream file{ m_settings.benchmarkFile };
+	if (!file)
+	{
+		throw std::runtime_error("Failed to write the benchmark report");
+	}
+
+	file << "{\n\t\"objects\": " << m_settings.sceneObjectCount
+		<< ",\n\t\"models\": " << m_settings.sceneModelCount
+		<< ",\n\t\"framesInFlight\": " << m_renderer.getFramesInFlight()
+		<< ",\n\t\"transforms\": \"" << (m_settings.pushConstantTransforms ? "push constants" : "storage buffer") << "\""
+		<< ",\n\t\"extent\": [" << m_renderer.getSwapChainExtent().width << ", " << m_renderer.getSwapChainExtent().height << "]"
+		<< ",\n\t\"cpuFrameTime\": ";
+	WriteTimingsJson(file, cpuFrameTimesMs);
+
+	// Without timestamp support there are no GPU timings, which is left as an empty object
+	file << ",\n\t\"gpu\": {";
+	bool first = true;
+	if (m_gpuProfiler != nullptr)
+	{
+		for (const GpuProfiler::PassStats& pass : m_gpuProfiler->getPassStats())
+		{
+			// The first frames are left out, like for the cpu
+			std::vector<double> samples = pass.samples;
+			if (pass.name != "Upload" && samples.size() > m_settings.benchmarkWarmupFrameCount)
+			{
+				samples.erase(samples.begin(), samples.begin() + m_settings.benchmarkWarmupFrameCount);
+			}
+
+			file << (first ? "\n" : ",\n") << "\t\t\"" << pass.name << "\": ";
+			WriteTimingsJson(file, samples);
+			first = false;
+		}
+	}
+	file << "\n\t}\n}\n";
+
+	std::cout << "Wrote benchmark report to " << m_settings.benchmarkFile << std::endl;
+}
+
+Entity Application::createEntity(const TransformComponent& transform)
+{
+	Entity entity = m_registry.create();
+	m_registry.add<TransformHandleComponent>(entity, m_transformSystem.createTransform(transform));
+
+	return entity;
+}
\ No newline at end of file
@@ -2,11 +2,18 @@
 
 #include "Window.h"
 #include "Device.h"
-#include "GameObject.h"
+#include "Model.h"
+#include "Registry.h"
+#include "Components.h"
+#include "TransformSystem.h"
+#include "SpatialIndex.h"
 #include "Renderer.h"
 #include "Descriptor.h"
+#include "ThreadPool.h"
+#include "GpuProfiler.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 class Application
@@ -15,17 +22,94 @@ public:
 	static constexpr int WIDTH = 720;
 	static constexpr int HEIGHT = 720;
 
+	struct Settings
+	{
+		// Record draws on worker threads into secondary command buffers
+		bool multithreadedRecording = false;
+
+		// Threads used for the multithreaded recording, 0 uses one for every hardware thread
+		uint32_t recordingThreadCount = 0;
+
+		// Skip drawing objects hidden behind the occluders, tested against a software rasterized depth buffer
+		bool occlusionCulling = false;
+
+		// Two-phase occlusion culling against a depth pyramid on the GPU, drawing with indirect draws
+		bool gpuOcclusionCulling = false;
+
+		// Skip the triangles that face away from the camera, the pipeline for it is compiled in the background while
+		// the frames are drawn without culling
+		bool backfaceCulling = false;
+
+		// Draw the depth of every object first (only reading positions), so the fragment shader only runs once per pixel
+		bool depthPrepass = false;
+
+		// Push both matrices with every draw instead of indexing the object buffer, to compare the two. Can't be
+		// combined with the depth pre-pass or GPU occlusion culling
+		bool pushConstantTransforms = false;
+
+		// Between SwapChain::MIN_FRAMES_IN_FLIGHT and SwapChain::MAX_FRAMES_IN_FLIGHT, fewer frames lower the latency
+		int framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+
+		// Synchronize the frames with a single timeline semaphore instead of fences (falls back to fences without Vulkan 1.2)
+		bool timelineSemaphore = false;
+
+		// Print the average frame time and latency every second
+		bool frameStats = false;
+
+		// Render offscreen without a window or surface (for machines without a display), without keyboard input
+		bool headless = false;
+
+		// Stop after this many frames, 0 keeps rendering until the window is closed (so it has to be set headless)
+		uint32_t frameCount = 0;
+
+		// Time the passes (and uploads) on the GPU, printed every second and written to gpuProfileFile when closing
+		// (as json when the name ends in .json, csv otherwise)
+		bool gpuProfiling = false;
+		std::string gpuProfileFile;
+
+		// Write the cpu zones of the first cpuProfileFrameCount frames to cpuProfileFile as Chrome trace events, only
+		// available in builds with CPU_PROFILING defined
+		std::string cpuProfileFile;
+		uint32_t cpuProfileFrameCount = 10;
+
+		// Scene benchmark: instead of the normal scene, sceneObjectCount objects spread over sceneModelCount generated
+		// models are rendered (from a fixed camera) and the frame times are written to benchmarkFile as json
+		uint32_t sceneObjectCount = 0;
+		uint32_t sceneModelCount = 8;
+		std::string benchmarkFile;
+		// Frames at the start that are left out of the benchmark, while caches and pipelines warm up
+		uint32_t benchmarkWarmupFrameCount = 30;
+
+		// Seconds that pass every frame for everything that moves, instead of the measured frame time (0)
+		float fixedTimestep = 0.0f;
+
+		// Write the viewer transform of every frame to cameraRecordFile when closing. Playing cameraPlaybackFile moves
+		// the viewer along a recorded path instead (ignoring the keyboard), one frame per timestep, and stops at its end
+		std::string cameraRecordFile;
+		std::string cameraPlaybackFile;
+	};
+
 private:
-	Window m_window{ "Vulkan practice", WIDTH, HEIGHT };
-	Device m_device{ m_window };
-	Renderer m_renderer{ m_window, m_device };
+	Settings m_settings;
+
+	Window m_window{ "Vulkan practice", WIDTH, HEIGHT, m_settings.headless };
+	Device m_device{ m_window, m_settings.timelineSemaphore };
+	Renderer m_renderer{ m_window, m_device, m_settings.framesInFlight };
 
 	std::unique_ptr<DescriptorPool> m_globalPool{};  
+	std::unique_ptr<ThreadPool> m_recordingThreads{};
+	std::unique_ptr<GpuProfiler> m_gpuProfiler{};
+
+	// Meshes only point to the models, so they are owned here for as long as the entities can use them
+	std::vector<std::unique_ptr<Model>> m_models;
+	std::vector<std::unique_ptr<OcclusionMesh>> m_occlusionMeshes;
 
-	std::vector<GameObject> m_gameObjects;
+	TransformSystem m_transformSystem;
+	Registry m_registry;
+	SpatialIndex m_spatialIndex;
 
 public:
-	Application();
+	Application(const Settings& settings);
 	~Application();
 
 	Application(const Application&) = delete;
@@ -34,5 +118,8 @@ public:
 	void run();
 
 private:
-	void loadGameObjects();
+	void loadEntities();
+	void loadBenchmarkScene();
+	void writeBenchmarkReport(const std::vector<double>& cpuFrameTimesMs);
+	Entity createEntity(const TransformComponent& transform = {});
 };
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+uint32_t BoundingVolumeHierarchy::createProxy(const AABB& bounds, uint32_t userData, bool deferInsertion)
+{
+	uint32_t proxy = allocateNode();
+	m_nodes[proxy].bounds = FattenBounds(bounds);
+	m_nodes[proxy].userData = userData;
+	m_leafCount++;
+
+	if (deferInsertion)
+	{
+		m_pendingLeaves.push_back(proxy);
+	}
+	else
+	{
+		insertLeaf(proxy);
+	}
+
+	return proxy;
+}
+
+void BoundingVolumeHierarchy::destroyProxy(uint32_t proxy)
+{
+	assert(m_nodes[proxy].isLeaf() && "Proxy has to be a leaf");
+
+	if (proxy != m_root && m_nodes[proxy].parent == NULL_NODE)
+	{
+		m_pendingLeaves.erase(std::find(m_pendingLeaves.begin(), m_pendingLeaves.end(), proxy));
+	}
+	else
+	{
+		removeLeaf(proxy);
+	}
+
+	freeNode(proxy);
+	m_leafCount--;
+}
+
+bool BoundingVolumeHierarchy::moveProxy(uint32_t proxy, const AABB& bounds)
+{
+	assert(m_nodes[proxy].isLeaf() && "Proxy has to be a leaf");
+
+	if (m_nodes[proxy].bounds.contains(bounds))
+	{
+		return false;
+	}
+
+	m_nodes[proxy].bounds = FattenBounds(bounds);
+	refit(m_nodes[proxy].parent);
+	m_refitsSinceRebuild++;
+
+	return true;
+}
+
+uint32_t BoundingVolumeHierarchy::getHeight() const
+{
+	return m_root == NULL_NODE ? 0 : getHeight(m_root);
+}
+
+bool BoundingVolumeHierarchy::optimize()
+{
+	if (!m_pendingLeaves.empty())
+	{
+		if (m_pendingLeaves.size() * 4 >= m_leafCount)
+		{
+			rebuild();
+			return true;
+		}
+
+		for (uint32_t leaf : m_pendingLeaves)
+		{
+			insertLeaf(leaf);
+		}
+
+		m_pendingLeaves.clear();
+	}
+
+	uint32_t threshold = std::max(REBUILD_MIN_REFITS, static_cast<uint32_t>(m_leafCount * REBUILD_REFIT_FRACTION));
+	if (m_refitsSinceRebuild < threshold)
+	{
+		return false;
+	}
+
+	rebuild();
+	return true;
+}
+
+void BoundingVolumeHierarchy::rebuild()
+{
+	m_refitsSinceRebuild = 0;
+
+	// Leaves keep their node (so proxy ids stay valid), all internal nodes get freed and built again
+	m_buildLeaves.clear();
+	m_buildLeaves.reserve(m_leafCount);
+	m_buildLeaves.insert(m_buildLeaves.end(), m_pendingLeaves.begin(), m_pendingLeaves.end());
+	m_pendingLeaves.clear();
+
+	std::vector<uint32_t> stack;
+	if (m_root != NULL_NODE)
+	{
+		stack.push_back(m_root);
+	}
+
+	while (!stack.empty())
+	{
+		uint32_t node = stack.back();
+		stack.pop_back();
+
+		if (m_nodes[node].isLeaf())
+		{
+			m_buildLeaves.push_back(node);
+		}
+		else
+		{
+			stack.push_back(m_nodes[node].left);
+			stack.push_back(m_nodes[node].right);
+			freeNode(node);
+		}
+	}
+
+	if (m_buildLeaves.empty())
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	m_root = buildRange(0, static_cast<uint32_t>(m_buildLeaves.size()));
+	m_nodes[m_root].parent = NULL_NODE;
+}
+
+uint32_t BoundingVolumeHierarchy::allocateNode()
+{
+	if (m_freeList == NULL_NODE)
+	{
+		m_nodes.emplace_back();
+		return static_cast<uint32_t>(m_nodes.size() - 1);
+	}
+
+	// Free nodes are linked through their parent index
+	uint32_t node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+	m_nodes[node] = Node{};
+
+	return node;
+}
+
+void BoundingVolumeHierarchy::freeNode(uint32_t node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].left = NULL_NODE;
+	m_nodes[node].right = NULL_NODE;
+	m_freeList = node;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(uint32_t leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the cheapest sibling, where the cost of a node is the surface area it adds to the tree
+	const AABB& leafBounds = m_nodes[leaf].bounds;
+	uint32_t index = m_root;
+	while (!m_nodes[index].isLeaf())
+	{
+		const Node& node = m_nodes[index];
+
+		float area = node.bounds.getSurfaceArea();
+		float combinedArea = AABB::Merge(node.bounds, leafBounds).getSurfaceArea();
+
+		// Cost of making a new parent for this node and the leaf, and the cost every child pays for growing this node
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto childCost = [&](uint32_t child)
+		{
+			const Node& childNode = m_nodes[child];
+			float mergedArea = AABB::Merge(childNode.bounds, leafBounds).getSurfaceArea();
+			return childNode.isLeaf() ? mergedArea + inheritanceCost : mergedArea - childNode.bounds.getSurfaceArea() + inheritanceCost;
+		};
+
+		float leftCost = childCost(node.left);
+		float rightCost = childCost(node.right);
+
+		if (cost < leftCost && cost < rightCost)
+		{
+			break;
+		}
+
+		index = leftCost < rightCost ? node.left : node.right;
+	}
+
+	uint32_t sibling = index;
+	uint32_t oldParent = m_nodes[sibling].parent;
+	uint32_t newParent = allocateNode();
+
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].left = sibling;
+	m_nodes[newParent].right = leaf;
+	m_nodes[newParent].bounds = AABB::Merge(m_nodes[sibling].bounds, m_nodes[leaf].bounds);
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE)
+	{
+		m_root = newParent;
+	}
+	else
+	{
+		if (m_nodes[oldParent].left == sibling)
+		{
+			m_nodes[oldParent].left = newParent;
+		}
+		else
+		{
+			m_nodes[oldParent].right = newParent;
+		}
+	}
+
+	refit(oldParent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(uint32_t leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// The parent gets replaced by the sibling of the leaf
+	uint32_t parent = m_nodes[leaf].parent;
+	uint32_t grandParent = m_nodes[parent].parent;
+	uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+	m_nodes[sibling].parent = grandParent;
+	if (grandParent == NULL_NODE)
+	{
+		m_root = sibling;
+	}
+	else
+	{
+		if (m_nodes[grandParent].left == parent)
+		{
+			m_nodes[grandParent].left = sibling;
+		}
+		else
+		{
+			m_nodes[grandParent].right = sibling;
+		}
+
+		refit(grandParent);
+	}
+
+	freeNode(parent);
+	m_nodes[leaf].parent = NULL_NODE;
+}
+
+void BoundingVolumeHierarchy::refit(uint32_t node)
+{
+	// Stops as soon as a box doesn't change anymore, since none of its ancestors will change either then
+	while (node != NULL_NODE)
+	{
+		Node& current = m_nodes[node];
+		AABB bounds = AABB::Merge(m_nodes[current.left].bounds, m_nodes[current.right].bounds);
+
+		if (bounds.min == current.bounds.min && bounds.max == current.bounds.max)
+		{
+			return;
+		}
+
+		current.bounds = bounds;
+		node = current.parent;
+	}
+}
+
+uint32_t BoundingVolumeHierarchy::buildRange(uint32_t begin, uint32_t end)
+{
+	if (end - begin == 1)
+	{
+		return m_buildLeaves[begin];
+	}
+
+	AABB centroidBounds{};
+	for (uint32_t i = begin; i < end; i++)
+	{
+		centroidBounds.expand(m_nodes[m_buildLeaves[i]].bounds.getCenter());
+	}
+
+	glm::vec3 size = centroidBounds.max - centroidBounds.min;
+	int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+	uint32_t middle = begin + (end - begin) / 2;
+
+	if (size[axis] > 0.0f)
+	{
+		// Binned surface area heuristic along the longest axis of the centroids
+		constexpr uint32_t BIN_COUNT = 12;
+
+		struct Bin
+		{
+			AABB bounds;
+			uint32_t count = 0;
+		};
+
+		Bin bins[BIN_COUNT];
+		float binScale = BIN_COUNT / size[axis];
+
+		auto binIndex = [&](uint32_t leaf)
+		{
+			float offset = m_nodes[leaf].bounds.getCenter()[axis] - centroidBounds.min[axis];
+			return std::min(static_cast<uint32_t>(offset * binScale), BIN_COUNT - 1);
+		};
+
+		for (uint32_t i = begin; i < end; i++)
+		{
+			Bin& bin = bins[binIndex(m_buildLeaves[i])];
+			bin.bounds = AABB::Merge(bin.bounds, m_nodes[m_buildLeaves[i]].bounds);
+			bin.count++;
+		}
+
+		// Sweep from the right to get the cost of everything right of every split, then from the left
+		float rightCosts[BIN_COUNT];
+		AABB rightBounds{};
+		uint32_t rightCount = 0;
+		for (uint32_t i = BIN_COUNT - 1; i > 0; i--)
+		{
+			rightBounds = AABB::Merge(rightBounds, bins[i].bounds);
+			rightCount += bins[i].count;
+			rightCosts[i] = rightCount > 0 ? rightBounds.getSurfaceArea() * rightCount : 0.0f;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestSplit = 0;
+		AABB leftBounds{};
+		uint32_t leftCount = 0;
+		for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+		{
+			leftBounds = AABB::Merge(leftBounds, bins[i].bounds);
+			leftCount += bins[i].count;
+
+			float cost = (leftCount > 0 ? leftBounds.getSurfaceArea() * leftCount : 0.0f) + rightCosts[i + 1];
+			if (leftCount > 0 && leftCount < end - begin && cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = i;
+			}
+		}
+
+		if (bestCost < std::numeric_limits<float>::max())
+		{
+			auto first = m_buildLeaves.begin();
+			middle = static_cast<uint32_t>(std::partition(first + begin, first + end, [&](uint32_t leaf) { return binIndex(leaf) <= bestSplit; }) - first);
+		}
+	}
+	else
+	{
+		// All centroids in the same spot, any split is as good as the other
+		middle = begin + (end - begin) / 2;
+	}
+
+	uint32_t left = buildRange(begin, middle);
+	uint32_t right = buildRange(middle, end);
+
+	uint32_t node = allocateNode();
+	m_nodes[node].left = left;
+	m_nodes[node].right = right;
+	m_nodes[node].bounds = AABB::Merge(m_nodes[left].bounds, m_nodes[right].bounds);
+	m_nodes[left].parent = node;
+	m_nodes[right].parent = node;
+
+	return node;
+}
+
+uint32_t BoundingVolumeHierarchy::getHeight(uint32_t node) const
+{
+	if (m_nodes[node].isLeaf())
+	{
+		return 1;
+	}
+
+	return 1 + std::max(getHeight(m_nodes[node].left), getHeight(m_nodes[node].right));
+}
+
+AABB BoundingVolumeHierarchy::FattenBounds(const AABB& bounds)
+{
+	glm::vec3 margin = glm::max((bounds.max - bounds.min) * FAT_MARGIN_FRACTION, glm::vec3(FAT_MARGIN_MIN));
+	return AABB{ bounds.min - margin, bounds.max + margin };
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Dynamic AABB tree over the bounds of objects. Every leaf is a proxy with a fat (enlarged) box, so objects that
+// move a little don't touch the tree at all. When an object leaves its fat box, its leaf gets a new fat box and
+// the boxes of its ancestors are refit. Refitting keeps the tree valid but slowly makes it worse, so after enough
+// refits optimize() rebuilds the whole tree with the surface area heuristic. Proxy ids stay the same across refits
+// and rebuilds
+class BoundingVolumeHierarchy
+{
+public:
+	static constexpr uint32_t NULL_NODE = std::numeric_limits<uint32_t>::max();
+
+	// Fat boxes are enlarged by this fraction of their size (plus a small absolute margin for tiny objects)
+	static constexpr float FAT_MARGIN_FRACTION = 0.1f;
+	static constexpr float FAT_MARGIN_MIN = 0.05f;
+
+	// optimize() rebuilds the tree once the amount of refits passes this fraction of the amount of leaves
+	static constexpr float REBUILD_REFIT_FRACTION = 0.5f;
+	static constexpr uint32_t REBUILD_MIN_REFITS = 64;
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		uint32_t parent = NULL_NODE;
+		uint32_t left = NULL_NODE;
+		uint32_t right = NULL_NODE;
+		uint32_t userData = 0;
+
+		bool isLeaf() const { return left == NULL_NODE; }
+	};
+
+	std::vector<Node> m_nodes;
+	uint32_t m_root = NULL_NODE;
+	uint32_t m_freeList = NULL_NODE;
+	uint32_t m_leafCount = 0;
+	uint32_t m_refitsSinceRebuild = 0;
+
+	// Proxies that are created but not inserted into the tree yet
+	std::vector<uint32_t> m_pendingLeaves;
+	std::vector<uint32_t> m_buildLeaves;
+
+public:
+	// A deferred proxy is only added to the tree by the next optimize() or rebuild() (and not returned by queries
+	// until then), which is a lot faster than inserting them one by one when adding many proxies at once
+	uint32_t createProxy(const AABB& bounds, uint32_t userData, bool deferInsertion = false);
+	void destroyProxy(uint32_t proxy);
+
+	// Returns true when the proxy left its fat box and the tree had to change
+	bool moveProxy(uint32_t proxy, const AABB& bounds);
+
+	uint32_t getUserData(uint32_t proxy) const { return m_nodes[proxy].userData; }
+	void setUserData(uint32_t proxy, uint32_t userData) { m_nodes[proxy].userData = userData; }
+	const AABB& getFatBounds(uint32_t proxy) const { return m_nodes[proxy].bounds; }
+
+	uint32_t getLeafCount() const { return m_leafCount; }
+	uint32_t getHeight() const;
+
+	// Inserts the deferred proxies and rebuilds the tree when it got refit too often since the last rebuild (or when
+	// many proxies were deferred), returns whether it rebuilt
+	bool optimize();
+	void rebuild();
+
+	// The query callbacks get the user data of every proxy whose fat box passes the test, so they can get
+	// some objects that are just outside of the query volume
+
+	template<typename Function>
+	void queryAABB(const AABB& bounds, Function&& callback) const
+	{
+		traverse([&](const Node& node) { return node.bounds.intersects(bounds); }, callback);
+	}
+
+	template<typename Function>
+	void querySphere(const glm::vec3& center, float radius, Function&& callback) const
+	{
+		traverse([&](const Node& node) { return node.bounds.intersectsSphere(center, radius); }, callback);
+	}
+
+	// Hierarchical culling: once a node is completely inside the frustum, its whole subtree is reported without
+	// any further tests, and planes a node is completely in front of are not tested again for its children
+	template<typename Function>
+	void queryFrustum(const Frustum& frustum, Function&& callback) const
+	{
+		if (m_root == NULL_NODE)
+		{
+			return;
+		}
+
+		struct Entry
+		{
+			uint32_t node;
+			uint32_t planeMask;
+		};
+
+		std::vector<Entry> stack;
+		stack.reserve(64);
+		stack.push_back(Entry{ m_root, Frustum::ALL_PLANES });
+
+		while (!stack.empty())
+		{
+			Entry entry = stack.back();
+			stack.pop_back();
+
+			const Node& node = m_nodes[entry.node];
+			Frustum::Containment containment = frustum.classify(node.bounds, entry.planeMask);
+
+			if (containment == Frustum::Containment::Outside)
+			{
+				continue;
+			}
+
+			if (containment == Frustum::Containment::Inside)
+			{
+				reportSubtree(entry.node, callback);
+			}
+			else if (node.isLeaf())
+			{
+				callback(node.userData);
+			}
+			else
+			{
+				stack.push_back(Entry{ node.left, entry.planeMask });
+				stack.push_back(Entry{ node.right, entry.planeMask });
+			}
+		}
+	}
+
+	// Calls callback(userData, maxDistance) for every proxy whose fat box the ray hits before maxDistance, closest
+	// boxes first. The callback returns the new max distance (the distance of its hit, or the max distance it got
+	// to keep going), so everything behind the closest hit so far gets skipped
+	template<typename Function>
+	void raycast(const Ray& ray, float maxDistance, Function&& callback) const
+	{
+		if (m_root == NULL_NODE)
+		{
+			return;
+		}
+
+		glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+		struct Entry
+		{
+			uint32_t node;
+			float distance;
+		};
+
+		std::vector<Entry> stack;
+		stack.reserve(64);
+
+		float distance;
+		if (m_nodes[m_root].bounds.intersectsRay(ray.origin, inverseDirection, maxDistance, distance))
+		{
+			stack.push_back(Entry{ m_root, distance });
+		}
+
+		while (!stack.empty())
+		{
+			Entry entry = stack.back();
+			stack.pop_back();
+
+			if (entry.distance > maxDistance)
+			{
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.node];
+			if (node.isLeaf())
+			{
+				maxDistance = callback(node.userData, maxDistance);
+				continue;
+			}
+
+			float leftDistance, rightDistance;
+			bool hitLeft = m_nodes[node.left].bounds.intersectsRay(ray.origin, inverseDirection, maxDistance, leftDistance);
+			bool hitRight = m_nodes[node.right].bounds.intersectsRay(ray.origin, inverseDirection, maxDistance, rightDistance);
+
+			// Push the farther child first, so the closer one gets visited first
+			if (hitLeft && hitRight)
+			{
+				bool leftFirst = leftDistance <= rightDistance;
+				stack.push_back(leftFirst ? Entry{ node.right, rightDistance } : Entry{ node.left, leftDistance });
+				stack.push_back(leftFirst ? Entry{ node.left, leftDistance } : Entry{ node.right, rightDistance });
+			}
+			else if (hitLeft)
+			{
+				stack.push_back(Entry{ node.left, leftDistance });
+			}
+			else if (hitRight)
+			{
+				stack.push_back(Entry{ node.right, rightDistance });
+			}
+		}
+	}
+
+private:
+	template<typename Test, typename Function>
+	void traverse(Test&& test, Function&& callback) const
+	{
+		if (m_root == NULL_NODE)
+		{
+			return;
+		}
+
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(m_root);
+
+		while (!stack.empty())
+		{
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			if (!test(node))
+			{
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				callback(node.userData);
+			}
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.right);
+			}
+		}
+	}
+
+	template<typename Function>
+	void reportSubtree(uint32_t root, Function&& callback) const
+	{
+		std::vector<uint32_t> stack;
+		stack.reserve(64);
+		stack.push_back(root);
+
+		while (!stack.empty())
+		{
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			if (node.isLeaf())
+			{
+				callback(node.userData);
+			}
+			else
+			{
+				stack.push_back(node.left);
+				stack.push_back(node.right);
+			}
+		}
+	}
+
+	uint32_t allocateNode();
+	void freeNode(uint32_t node);
+
+	void insertLeaf(uint32_t leaf);
+	void removeLeaf(uint32_t leaf);
+	void refit(uint32_t node);
+
+	uint32_t buildRange(uint32_t begin, uint32_t end);
+	uint32_t getHeight(uint32_t node) const;
+
+	static AABB FattenBounds(const AABB& bounds);
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "Bounds.h"
+
+AABB AABB::transformed(const glm::mat4& matrix) const
+{
+	if (isEmpty())
+	{
+		return *this;
+	}
+
+	// Transforms the center and projects the extent on every axis (Arvo), instead of transforming all 8 corners
+	glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+	glm::vec3 extent = getExtent();
+
+	glm::mat3 absolute
+	{
+		glm::abs(glm::vec3(matrix[0])),
+		glm::abs(glm::vec3(matrix[1])),
+		glm::abs(glm::vec3(matrix[2]))
+	};
+
+	glm::vec3 transformedExtent = absolute * extent;
+	return AABB{ center - transformedExtent, center + transformedExtent };
+}
+
+Frustum Frustum::FromViewProjection(const glm::mat4& viewProjection)
+{
+	// Gribb/Hartmann plane extraction, glm is column major so the rows have to be gathered
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	Frustum frustum{};
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	for (auto& plane : frustum.planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return frustum;
+}
+
+Frustum::Containment Frustum::classify(const AABB& bounds, uint32_t& planeMask) const
+{
+	glm::vec3 center = bounds.getCenter();
+	glm::vec3 extent = bounds.getExtent();
+
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		if ((planeMask & (1u << i)) == 0)
+		{
+			continue;
+		}
+
+		glm::vec3 normal = glm::vec3(planes[i]);
+		float distance = glm::dot(normal, center) + planes[i].w;
+		float radius = glm::dot(glm::abs(normal), extent);
+
+		if (distance < -radius)
+		{
+			return Containment::Outside;
+		}
+
+		if (distance >= radius)
+		{
+			planeMask &= ~(1u << i);
+		}
+	}
+
+	return planeMask == 0 ? Containment::Inside : Containment::Intersecting;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+// Axis aligned bounding box, an empty box has min > max so merging anything into it gives that thing back
+struct AABB
+{
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+	static AABB Merge(const AABB& a, const AABB& b) { return AABB{ glm::min(a.min, b.min), glm::max(a.max, b.max) }; }
+
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+	glm::vec3 getExtent() const { return (max - min) * 0.5f; }
+
+	float getSurfaceArea() const
+	{
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	void expand(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	bool contains(const AABB& other) const { return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max)); }
+	bool intersects(const AABB& other) const { return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min)); }
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		glm::vec3 closest = glm::clamp(center, min, max);
+		glm::vec3 offset = closest - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+
+	// Slab test, inverseDirection is 1 / direction of the ray (infinities for axis aligned rays are fine)
+	bool intersectsRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const
+	{
+		glm::vec3 t1 = (min - origin) * inverseDirection;
+		glm::vec3 t2 = (max - origin) * inverseDirection;
+		glm::vec3 tMin = glm::min(t1, t2);
+		glm::vec3 tMax = glm::max(t1, t2);
+
+		float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+		float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+
+		distance = enter;
+		return enter <= exit;
+	}
+
+	// Bounds of this box after transforming it (the result can be larger than the bounds of the transformed mesh)
+	AABB transformed(const glm::mat4& matrix) const;
+};
+
+struct Ray
+{
+	glm::vec3 origin{};
+	glm::vec3 direction{ 0.0f, 0.0f, 1.0f };
+};
+
+// The six planes of a view frustum, pointing inwards (xyz is the normal, w the distance)
+struct Frustum
+{
+	enum class Containment
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+
+	static constexpr uint32_t ALL_PLANES = 0x3f;
+
+	glm::vec4 planes[6];
+
+	// Works for the Vulkan clip space (depth 0 to 1)
+	static Frustum FromViewProjection(const glm::mat4& viewProjection);
+
+	// Only tests the planes in planeMask, and removes the planes the box is completely in front of from it, so
+	// children of a box don't have to test them again
+	Containment classify(const AABB& bounds, uint32_t& planeMask) const;
+};
\ No newline at end of file
@@ -44,8 +44,14 @@ Buffer::Buffer(
 Buffer::~Buffer()
 {
     unmap();
-    vkDestroyBuffer(device.device(), buffer, nullptr);
-    vkFreeMemory(device.device(), memory, nullptr);
+
+    // The buffer might still be read by frames in flight
+    VkBuffer retiredBuffer = buffer;
+    VkDeviceMemory retiredMemory = memory;
+    device.destroyDeferred([retiredBuffer, retiredMemory](VkDevice vkDevice) {
+        vkDestroyBuffer(vkDevice, retiredBuffer, nullptr);
+        vkFreeMemory(vkDevice, retiredMemory, nullptr);
+    });
 }
 
 /**
@@ -0,0 +1,58 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+static constexpr char MAGIC[4] = { 'C', 'P', 'T', 'H' };
+static constexpr uint32_t VERSION = 1;
+
+// Frames are written and read as they are in memory
+static_assert(sizeof(CameraPath::Frame) == 6 * sizeof(float));
+
+CameraPath CameraPath::LoadFromFile(const std::string& filePath)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open camera path: " + filePath);
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t frameCount = 0;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&frameCount), sizeof(frameCount));
+
+	if (!file || !std::equal(magic, magic + 4, MAGIC) || version != VERSION || frameCount == 0)
+	{
+		throw std::runtime_error("Failed to read camera path, not a (non empty) version " + std::to_string(VERSION) + " path: " + filePath);
+	}
+
+	CameraPath path{};
+	path.m_frames.resize(frameCount);
+	file.read(reinterpret_cast<char*>(path.m_frames.data()), frameCount * sizeof(Frame));
+
+	if (!file)
+	{
+		throw std::runtime_error("Failed to read camera path, the file is cut off: " + filePath);
+	}
+
+	return path;
+}
+
+void CameraPath::saveToFile(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to write camera path: " + filePath);
+	}
+
+	uint32_t frameCount = getFrameCount();
+	file.write(MAGIC, sizeof(MAGIC));
+	file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+	file.write(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+	file.write(reinterpret_cast<const char*>(m_frames.data()), m_frames.size() * sizeof(Frame));
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The transform of the viewer for every frame, so a run can be repeated with exactly the same views. Saved as a small
+// binary file: a header (magic, version, frame count) followed by the translation and rotation of every frame
+class CameraPath
+{
+public:
+	// Timestep of a playback when none is given, a path has one frame per timestep
+	static constexpr float DEFAULT_TIMESTEP = 1.0f / 60.0f;
+
+	struct Frame
+	{
+		glm::vec3 translation;
+		glm::vec3 rotation;
+	};
+
+private:
+	std::vector<Frame> m_frames;
+
+public:
+	static CameraPath LoadFromFile(const std::string& filePath);
+	void saveToFile(const std::string& filePath) const;
+
+	void addFrame(const glm::vec3& translation, const glm::vec3& rotation) { m_frames.push_back(Frame{ translation, rotation }); }
+
+	// Past the end the last frame is held
+	const Frame& getFrame(uint32_t index) const { return m_frames[std::min<size_t>(index, m_frames.size() - 1)]; }
+	uint32_t getFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "CommandPool.h"
+
+#include <stdexcept>
+
+CommandPool::CommandPool(Device& device, VkCommandPoolCreateFlags flags): m_device(device)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = m_device.findPhysicalQueueFamilies().graphicsFamily;
+	poolInfo.flags = flags;
+
+	VkResult result = vkCreateCommandPool(m_device.device(), &poolInfo, nullptr, &m_commandPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create command pool");
+	}
+}
+
+CommandPool::~CommandPool()
+{
+	// Destroying the pool also frees all command buffers allocated from it, which might still be pending
+	VkCommandPool commandPool = m_commandPool;
+	m_device.destroyDeferred([commandPool](VkDevice device) { vkDestroyCommandPool(device, commandPool, nullptr); });
+}
+
+VkCommandBuffer CommandPool::requestCommandBuffer(VkCommandBufferLevel level)
+{
+	bool isPrimary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	auto& commandBuffers = isPrimary ? m_primaryCommandBuffers : m_secondaryCommandBuffers;
+	uint32_t& usedCount = isPrimary ? m_usedPrimaryCount : m_usedSecondaryCount;
+
+	if (usedCount < commandBuffers.size())
+	{
+		return commandBuffers[usedCount++];
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = level;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	VkResult result = vkAllocateCommandBuffers(m_device.device(), &allocInfo, &commandBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate command buffer");
+	}
+
+	commandBuffers.push_back(commandBuffer);
+	usedCount++;
+
+	return commandBuffer;
+}
+
+void CommandPool::reset()
+{
+	vkResetCommandPool(m_device.device(), m_commandPool, 0);
+
+	m_usedPrimaryCount = 0;
+	m_usedSecondaryCount = 0;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Device.h"
+
+#include <vector>
+
+// Command pool that hands out command buffers until it gets reset as a whole. Allocated command buffers are kept
+// and recycled after a reset, so a pool that is used every frame stops allocating after the first few frames.
+// A pool (and every command buffer it handed out) may only be used by one thread at a time
+class CommandPool
+{
+private:
+	Device& m_device;
+	VkCommandPool m_commandPool;
+
+	std::vector<VkCommandBuffer> m_primaryCommandBuffers;
+	std::vector<VkCommandBuffer> m_secondaryCommandBuffers;
+	uint32_t m_usedPrimaryCount = 0;
+	uint32_t m_usedSecondaryCount = 0;
+
+public:
+	CommandPool(Device& device, VkCommandPoolCreateFlags flags = 0);
+	~CommandPool();
+
+	CommandPool(const CommandPool&) = delete;
+	CommandPool& operator=(const CommandPool&) = delete;
+
+	VkCommandBuffer requestCommandBuffer(VkCommandBufferLevel level);
+
+	// All command buffers handed out by this pool must have finished executing on the GPU
+	void reset();
+
+	VkCommandPool getCommandPool() const { return m_commandPool; }
+};
\ No newline at end of file
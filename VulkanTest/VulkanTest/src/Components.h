@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Model.h"
+#include "TransformSystem.h"
+#include "OcclusionCuller.h"
+
+// Components that can be attached to entities in the Registry. They are plain data, the behaviour lives in the
+// systems that iterate over them
+
+// The transform data itself lives in the TransformSystem (structure-of-arrays), this is the id of it
+struct TransformHandleComponent
+{
+	TransformSystem::id_t transformId = TransformSystem::INVALID_ID;
+};
+
+// The model is owned by the application, so drawing doesn't have to touch any reference counts
+struct MeshComponent
+{
+	Model* model = nullptr;
+};
+
+// Moved around by the KeyboardMovementController
+struct KeyboardControlComponent
+{
+};
+
+// Rendered into the occlusion buffer every frame, the mesh is owned by the application like the models
+struct OccluderComponent
+{
+	const OcclusionMesh* mesh = nullptr;
+};
\ No newline at end of file
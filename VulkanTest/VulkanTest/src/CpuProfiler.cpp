@@ -0,0 +1,123 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+CpuProfiler& CpuProfiler::Get()
+{
+	static CpuProfiler profiler;
+	return profiler;
+}
+
+int64_t CpuProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::getThreadBuffer()
+{
+	// Registering is the only time a thread takes the lock
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+	if (threadBuffer == nullptr)
+	{
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->events = std::make_unique<Event[]>(RING_CAPACITY);
+
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		buffer->threadId = static_cast<uint32_t>(m_threads.size());
+		threadBuffer = buffer.get();
+		m_threads.push_back(std::move(buffer));
+	}
+
+	return *threadBuffer;
+}
+
+void CpuProfiler::record(const char* name, int64_t beginNs, int64_t endNs)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+	buffer.events[index & (RING_CAPACITY - 1)] = Event{ name, beginNs, endNs };
+	buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::markFrame()
+{
+	if (m_captureFrameCount == 0)
+	{
+		return;
+	}
+
+	int64_t now = Now();
+	if (!m_capturing)
+	{
+		m_capturing = true;
+		m_captureBeginNs = now;
+		m_frameBeginNs.clear();
+	}
+	else if (m_frameBeginNs.size() >= m_captureFrameCount)
+	{
+		writeCapture(now);
+
+		m_capturing = false;
+		m_captureFrameCount = 0;
+		return;
+	}
+
+	m_frameBeginNs.push_back(now);
+}
+
+void CpuProfiler::requestCapture(const std::string& path, uint32_t frameCount)
+{
+	m_capturePath = path;
+	m_captureFrameCount = frameCount;
+	m_capturing = false;
+}
+
+void CpuProfiler::writeCapture(int64_t endNs)
+{
+	std::ofstream file{ m_capturePath };
+	if (!file)
+	{
+		std::cerr << "Failed to write cpu profile to " << m_capturePath << std::endl;
+		return;
+	}
+
+	// Chrome trace events are in microseconds, relative to the start of the capture
+	auto toMicroseconds = [this](int64_t ns) { return static_cast<double>(ns - m_captureBeginNs) / 1000.0; };
+
+	file << "{\"traceEvents\":[";
+	bool first = true;
+
+	for (size_t i = 0; i < m_frameBeginNs.size(); i++)
+	{
+		file << (first ? "\n" : ",\n") << "{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":"
+			<< toMicroseconds(m_frameBeginNs[i]) << "}";
+		first = false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	for (const auto& buffer : m_threads)
+	{
+		uint64_t writeIndex = buffer->writeIndex.load(std::memory_order_acquire);
+		uint64_t firstIndex = writeIndex > RING_CAPACITY ? writeIndex - RING_CAPACITY : 0;
+
+		for (uint64_t index = firstIndex; index < writeIndex; index++)
+		{
+			const Event& event = buffer->events[index & (RING_CAPACITY - 1)];
+			if (event.beginNs < m_captureBeginNs || event.endNs > endNs)
+			{
+				continue;
+			}
+
+			file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << toMicroseconds(event.beginNs) << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) / 1000.0 << "}";
+			first = false;
+		}
+	}
+
+	file << "\n]}\n";
+	std::cout << "Wrote cpu profile of " << m_frameBeginNs.size() << " frames to " << m_capturePath << std::endl;
+}
\ No newline at end of file
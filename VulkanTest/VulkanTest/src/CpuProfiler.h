@@ -0,0 +1,89 @@
+#pragma once
+
+// Build with CPU_PROFILING defined to record the zones, without it the macros compile to nothing
+#ifdef CPU_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope, name has to be a string literal (only the pointer is stored)
+#define PROFILE_ZONE(name) CpuProfiler::Zone PROFILE_CONCAT(profileZone, __LINE__){ name }
+// Called once at the start of every frame on the main thread
+#define PROFILE_FRAME() CpuProfiler::Get().markFrame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records timed zones into a ring buffer per thread. Only the owning thread writes to its ring (without locking), the
+// oldest zones get overwritten once it's full. A capture of the next few frames can be requested, which is written
+// as Chrome trace events (to open in chrome://tracing or Perfetto) at the frame marker after the last frame. The
+// rings are read at that moment, so other threads should not be recording zones then (the recording threads only
+// work while the main thread waits on them)
+class CpuProfiler
+{
+public:
+	// Zones per thread that are kept, a capture can't hold more than this per thread
+	static constexpr uint32_t RING_CAPACITY = 1 << 16;
+
+	struct Event
+	{
+		const char* name;
+		int64_t beginNs;
+		int64_t endNs;
+	};
+
+	class Zone
+	{
+	private:
+		const char* m_name;
+		int64_t m_beginNs;
+
+	public:
+		Zone(const char* name): m_name(name), m_beginNs(Now()) {}
+		~Zone() { Get().record(m_name, m_beginNs, Now()); }
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+
+private:
+	struct ThreadBuffer
+	{
+		uint32_t threadId;
+		std::unique_ptr<Event[]> events;
+		std::atomic<uint64_t> writeIndex{ 0 };
+	};
+
+	// Owned here instead of by the threads, so the zones of a thread that has exited can still be written out
+	std::mutex m_threadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+	// Only used by the thread that marks the frames
+	std::string m_capturePath;
+	uint32_t m_captureFrameCount = 0;
+	bool m_capturing = false;
+	int64_t m_captureBeginNs = 0;
+	std::vector<int64_t> m_frameBeginNs;
+
+public:
+	static CpuProfiler& Get();
+	static int64_t Now();
+
+	void record(const char* name, int64_t beginNs, int64_t endNs);
+	void markFrame();
+
+	// Captures the frameCount frames that start at the next frame marker
+	void requestCapture(const std::string& path, uint32_t frameCount);
+
+private:
+	CpuProfiler() = default;
+
+	ThreadBuffer& getThreadBuffer();
+	void writeCapture(int64_t endNs);
+};
\ No newline at end of file
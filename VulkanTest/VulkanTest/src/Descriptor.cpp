@@ -49,7 +49,10 @@ DescriptorSetLayout::DescriptorSetLayout(
 }
 
 DescriptorSetLayout::~DescriptorSetLayout() {
-    vkDestroyDescriptorSetLayout(lveDevice.device(), descriptorSetLayout, nullptr);
+    VkDescriptorSetLayout setLayout = descriptorSetLayout;
+    lveDevice.destroyDeferred([setLayout](VkDevice device) {
+        vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+    });
 }
 
 // *************** Descriptor Pool Builder *********************
@@ -96,7 +99,11 @@ DescriptorPool::DescriptorPool(
 }
 
 DescriptorPool::~DescriptorPool() {
-    vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+    // Destroying the pool frees its sets, which might still be bound in frames in flight
+    VkDescriptorPool pool = descriptorPool;
+    lveDevice.destroyDeferred([pool](VkDevice device) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    });
 }
 
 bool DescriptorPool::allocateDescriptorSet(
@@ -1,8 +1,13 @@
 #include "Device.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
@@ -46,16 +51,25 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-Device::Device(Window& window) : window{ window } {
+Device::Device(Window& window, bool timelineSemaphore)
+    : window{ window }, timelineSemaphoreRequested{ timelineSemaphore } {
+    if (isHeadless()) {
+        deviceExtensions.clear();
+    }
+
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    createTimelineSemaphore();
 }
 
 Device::~Device() {
+    flushDeferredDestructions();
+
+    vkDestroySemaphore(device_, timelineSemaphore, nullptr);
     vkDestroyCommandPool(device_, commandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
 
@@ -63,10 +77,54 @@ Device::~Device() {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface_, nullptr);
+    if (surface_ != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface_, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 }
 
+void Device::destroyDeferred(DestroyFunction destroy, uint64_t lastUsedFrame) {
+    std::lock_guard<std::mutex> lock(deferredMutex);
+    deferredDestructions.push_back(DeferredDestruction{ lastUsedFrame, std::move(destroy) });
+}
+
+void Device::collectDeferredDestructions(uint64_t completedFrameCount) {
+    // Run outside of the lock, destroying an object can queue more destructions
+    std::vector<DeferredDestruction> ready;
+    {
+        std::lock_guard<std::mutex> lock(deferredMutex);
+
+        auto notDone = [completedFrameCount](const DeferredDestruction& entry) { return entry.lastUsedFrame >= completedFrameCount; };
+        auto firstDone = std::stable_partition(deferredDestructions.begin(), deferredDestructions.end(), notDone);
+
+        ready.assign(std::make_move_iterator(firstDone), std::make_move_iterator(deferredDestructions.end()));
+        deferredDestructions.erase(firstDone, deferredDestructions.end());
+    }
+
+    for (auto& entry : ready) {
+        entry.destroy(device_);
+    }
+}
+
+void Device::flushDeferredDestructions() {
+    // Destroying an object can queue more destructions, so keep going until nothing is left
+    while (true) {
+        std::vector<DeferredDestruction> ready;
+        {
+            std::lock_guard<std::mutex> lock(deferredMutex);
+            ready.swap(deferredDestructions);
+        }
+
+        if (ready.empty()) {
+            break;
+        }
+
+        for (auto& entry : ready) {
+            entry.destroy(device_);
+        }
+    }
+}
+
 void Device::createInstance() {
     if (enableValidationLayers && !checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested, but not available!");
@@ -78,7 +136,15 @@ void Device::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Timeline semaphores are core in Vulkan 1.2, otherwise the instance stays on 1.0
+    if (timelineSemaphoreRequested) {
+        uint32_t supportedVersion = VK_API_VERSION_1_0;
+        vkEnumerateInstanceVersion(&supportedVersion);
+        if (supportedVersion >= VK_API_VERSION_1_2) {
+            instanceApiVersion = VK_API_VERSION_1_2;
+        }
+    }
+    appInfo.apiVersion = instanceApiVersion;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -149,9 +215,16 @@ void Device::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // Optional, only needed for GPU driven drawing (which checks enabledFeatures before using it)
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -159,6 +232,19 @@ void Device::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    if (timelineSemaphoreRequested) {
+        timelineSemaphoreEnabled = checkTimelineSemaphoreSupport();
+        if (timelineSemaphoreEnabled) {
+            createInfo.pNext = &timelineFeatures;
+        }
+        else {
+            std::cout << "timeline semaphores not supported, falling back to fences" << std::endl;
+        }
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -176,6 +262,8 @@ void Device::createLogicalDevice() {
         throw std::runtime_error("failed to create logical device!");
     }
 
+    enabledFeatures = deviceFeatures;
+
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
 }
@@ -186,23 +274,44 @@ void Device::createCommandPool() {
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-    poolInfo.flags =
-        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Only used for single time commands, which are freed right after they are done
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
     if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
 }
 
-void Device::createSurface() { window.createWindowSurface(instance, &surface_); }
+void Device::createTimelineSemaphore() {
+    if (!timelineSemaphoreEnabled) return;
+
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+void Device::createSurface() {
+    if (isHeadless()) return;
+    window.createWindowSurface(instance, &surface_);
+}
 
 bool Device::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    // Headless rendering doesn't present, so it doesn't need a swap chain
+    bool swapChainAdequate = isHeadless();
+    if (extensionsSupported && !isHeadless()) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -214,6 +323,22 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) {
         supportedFeatures.samplerAnisotropy;
 }
 
+bool Device::checkTimelineSemaphoreSupport() {
+    if (instanceApiVersion < VK_API_VERSION_1_2 || properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
 void Device::populateDebugMessengerCreateInfo(
     VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
     createInfo = {};
@@ -262,11 +387,14 @@ bool Device::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> Device::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (!isHeadless()) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -333,8 +461,14 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
             indices.graphicsFamily = i;
             indices.graphicsFamilyHasValue = true;
         }
+        // Without a surface nothing is presented, the graphics queue stands in for the present queue
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        if (isHeadless()) {
+            presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT ? VK_TRUE : VK_FALSE;
+        }
+        else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        }
         if (queueFamily.queueCount > 0 && presentSupport) {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
@@ -436,6 +570,62 @@ void Device::createBuffer(
     vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
 
+VkResult Device::submitToGraphicsQueue(const VkSubmitInfo& submitInfo, VkFence fence, uint64_t* signaledValue) {
+    PROFILE_ZONE("vkQueueSubmit");
+
+    std::lock_guard<std::mutex> lock(submitMutex);
+
+    if (!timelineSemaphoreEnabled) {
+        return vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+    }
+
+    // The timeline semaphore is signaled after the semaphores of the submit, whose (binary) values are ignored
+    std::vector<VkSemaphore> signalSemaphores(
+        submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+
+    uint64_t value = lastTimelineValue + 1;
+    signalSemaphores.push_back(timelineSemaphore);
+    signalValues.push_back(value);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = submitInfo.pNext;
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo timelineSubmitInfo = submitInfo;
+    timelineSubmitInfo.pNext = &timelineInfo;
+    timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    VkResult result = vkQueueSubmit(graphicsQueue_, 1, &timelineSubmitInfo, fence);
+    if (result == VK_SUCCESS) {
+        lastTimelineValue = value;
+        if (signaledValue != nullptr) {
+            *signaledValue = value;
+        }
+    }
+
+    return result;
+}
+
+uint64_t Device::getCompletedTimelineValue() {
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(device_, timelineSemaphore, &value);
+    return value;
+}
+
+void Device::waitTimelineValue(uint64_t value) {
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timelineSemaphore;
+    waitInfo.pValues = &value;
+
+    vkWaitSemaphores(device_, &waitInfo, std::numeric_limits<uint64_t>::max());
+}
+
 VkCommandBuffer Device::beginSingleTimeCommands() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -451,10 +641,19 @@ VkCommandBuffer Device::beginSingleTimeCommands() {
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    if (gpuProfiler != nullptr) {
+        gpuProfiler->beginUpload(commandBuffer);
+    }
+
     return commandBuffer;
 }
 
 void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+    if (gpuProfiler != nullptr) {
+        gpuProfiler->endUpload(commandBuffer);
+    }
+
     vkEndCommandBuffer(commandBuffer);
 
     VkSubmitInfo submitInfo{};
@@ -462,8 +661,22 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    uint64_t signaledValue = 0;
+    if (submitToGraphicsQueue(submitInfo, VK_NULL_HANDLE, &signaledValue) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit single time commands!");
+    }
+
+    // Only waits for this submit, not for the frames that are still in flight
+    if (timelineSemaphoreEnabled) {
+        waitTimelineValue(signaledValue);
+    }
+    else {
+        vkQueueWaitIdle(graphicsQueue_);
+    }
+
+    if (gpuProfiler != nullptr) {
+        gpuProfiler->collectUpload();
+    }
 
     vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
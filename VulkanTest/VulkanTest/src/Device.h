@@ -3,6 +3,9 @@
 #include "Window.h"
 
 // std lib headers
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -20,6 +23,8 @@ struct QueueFamilyIndices {
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+class GpuProfiler;
+
 class Device {
 public:
 #ifdef NDEBUG
@@ -28,7 +33,8 @@ public:
     const bool enableValidationLayers = true;
 #endif
 
-    Device(Window& window);
+    // The timeline semaphore is opt-in, without Vulkan 1.2 support the frames are synchronized with fences instead
+    Device(Window& window, bool timelineSemaphore = false);
     ~Device();
 
     // Not copyable or movable
@@ -37,12 +43,17 @@ public:
     Device(Device&&) = delete;
     Device& operator=(Device&&) = delete;
 
+    // Transient pool for the single time (upload) commands only, frames record from their own pools
     VkCommandPool getCommandPool() { return commandPool; }
     VkDevice device() { return device_; }
     VkSurfaceKHR surface() { return surface_; }
+    // Without a surface (and swap chain extension) when the window is headless, the swap chain renders offscreen
+    bool isHeadless() const { return window.isHeadless(); }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
 
+    VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
+
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
@@ -56,6 +67,19 @@ public:
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
         VkDeviceMemory& bufferMemory);
+    // Every submit to the graphics queue goes through here. With the timeline semaphore enabled it also signals the
+    // next timeline value, which is written to signaledValue
+    VkResult submitToGraphicsQueue(const VkSubmitInfo& submitInfo, VkFence fence, uint64_t* signaledValue = nullptr);
+
+    // A single timeline semaphore that counts the submits, so waiting for a submit is waiting for "value >= n"
+    // instead of resetting and polling a fence per submit
+    bool isTimelineSemaphoreEnabled() const { return timelineSemaphoreEnabled; }
+    uint64_t getCompletedTimelineValue();
+    void waitTimelineValue(uint64_t value);
+
+    // Times the single time commands on the GPU, pass nullptr to stop
+    void setGpuProfiler(GpuProfiler* profiler) { gpuProfiler = profiler; }
+
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,7 +92,24 @@ public:
         VkImage& image,
         VkDeviceMemory& imageMemory);
 
+    // Deferred destruction: objects the GPU might still be using are handed over together with the frame they were
+    // last used in, and destroyed once the GPU finished that frame. Without a frame, the frame that is currently
+    // being recorded is used. Can be called from any thread
+    using DestroyFunction = std::function<void(VkDevice device)>;
+    void destroyDeferred(DestroyFunction destroy) { destroyDeferred(std::move(destroy), currentFrame.load()); }
+    void destroyDeferred(DestroyFunction destroy, uint64_t lastUsedFrame);
+
+    // The frames are counted by the renderer, which moves the current frame forward on every submit and collects
+    // everything that was last used before the first frame that is not yet done
+    uint64_t getCurrentFrame() const { return currentFrame.load(); }
+    void setCurrentFrame(uint64_t frame) { currentFrame.store(frame); }
+    void collectDeferredDestructions(uint64_t completedFrameCount);
+
+    // Destroys everything that is still queued, the device has to be idle
+    void flushDeferredDestructions();
+
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures;
 
 private:
     void createInstance();
@@ -77,6 +118,7 @@ private:
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void createTimelineSemaphore();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -86,6 +128,7 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkTimelineSemaphoreSupport();
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
@@ -93,12 +136,31 @@ private:
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     Window& window;
     VkCommandPool commandPool;
+    GpuProfiler* gpuProfiler = nullptr;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
 
+    bool timelineSemaphoreRequested;
+    bool timelineSemaphoreEnabled = false;
+    uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+    VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+    // The signal values have to increase in submission order, so picking the next value and submitting is locked
+    std::mutex submitMutex;
+    uint64_t lastTimelineValue = 0;
+
+    struct DeferredDestruction {
+        uint64_t lastUsedFrame;
+        DestroyFunction destroy;
+    };
+
+    std::atomic<uint64_t> currentFrame{ 0 };
+    std::mutex deferredMutex;
+    std::vector<DeferredDestruction> deferredDestructions;
+
     const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-    const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    // Emptied when headless
+    std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 };
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize AlignUp(VkDeviceSize size, VkDeviceSize alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+FrameAllocator::FrameAllocator(Device& device, int framesInFlight, VkDeviceSize capacity, VkBufferUsageFlags usageFlags):
+	m_device(device)
+{
+	const VkPhysicalDeviceLimits& limits = m_device.properties.limits;
+
+	m_alignment = 1;
+	if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+	{
+		m_alignment = std::max(m_alignment, limits.minUniformBufferOffsetAlignment);
+	}
+	if (usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+	{
+		m_alignment = std::max(m_alignment, limits.minStorageBufferOffsetAlignment);
+	}
+
+	// The memory isn't host coherent, flushed ranges have to be multiples of nonCoherentAtomSize
+	m_capacity = AlignUp(AlignUp(capacity, m_alignment), std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1));
+
+	m_buffers.resize(framesInFlight);
+	m_offsets = std::make_unique<std::atomic<VkDeviceSize>[]>(framesInFlight);
+
+	for (int i = 0; i < framesInFlight; i++)
+	{
+		m_buffers[i] = std::make_unique<Buffer>
+		(
+			m_device,
+			m_capacity,
+			1,
+			usageFlags,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		);
+
+		m_buffers[i]->map();
+		m_offsets[i].store(0);
+	}
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(int frameIndex, VkDeviceSize size)
+{
+	// Every allocation is a multiple of the alignment, so every offset stays aligned
+	VkDeviceSize alignedSize = AlignUp(std::max<VkDeviceSize>(size, 1), m_alignment);
+	VkDeviceSize offset = m_offsets[frameIndex].fetch_add(alignedSize);
+
+	if (offset + alignedSize > m_capacity)
+	{
+		throw std::runtime_error("Frame allocator is out of space");
+	}
+
+	return Allocation{ static_cast<char*>(m_buffers[frameIndex]->getMappedMemory()) + offset, static_cast<uint32_t>(offset) };
+}
+
+void FrameAllocator::flush(int frameIndex)
+{
+	VkDeviceSize usedSize = std::min(m_offsets[frameIndex].load(), m_capacity);
+	if (usedSize == 0)
+	{
+		return;
+	}
+
+	VkDeviceSize atomSize = std::max<VkDeviceSize>(m_device.properties.limits.nonCoherentAtomSize, 1);
+	m_buffers[frameIndex]->flush(std::min(AlignUp(usedSize, atomSize), m_capacity), 0);
+}
+
+VkDescriptorBufferInfo FrameAllocator::descriptorInfo(int frameIndex, VkDeviceSize range) const
+{
+	return VkDescriptorBufferInfo{ m_buffers[frameIndex]->getBuffer(), 0, range };
+}
\ No newline at end of file
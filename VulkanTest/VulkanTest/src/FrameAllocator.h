@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Linear (bump) allocator for data that only lives for one frame, like uniforms. Every frame in flight has one large
+// persistently mapped buffer, allocations take the next aligned range of it and are bound through dynamic offsets
+// (so one descriptor set per frame covers everything). Everything of a frame is released at once with reset, which
+// may only be called once the frame is done on the GPU (after Renderer::beginFrame returned that frame index)
+class FrameAllocator
+{
+public:
+	struct Allocation
+	{
+		void* data;
+		// Offset into getBuffer, to be used as the dynamic offset
+		uint32_t offset;
+	};
+
+	static constexpr VkDeviceSize DEFAULT_CAPACITY = 256 * 1024;
+
+private:
+	Device& m_device;
+	VkDeviceSize m_capacity;
+	VkDeviceSize m_alignment;
+
+	std::vector<std::unique_ptr<Buffer>> m_buffers;
+	// Allocating only moves the offset forward, so several recording threads can allocate at the same time
+	std::unique_ptr<std::atomic<VkDeviceSize>[]> m_offsets;
+
+public:
+	// usageFlags decides which offset alignment the allocations honour (uniform and/or storage buffers)
+	FrameAllocator(Device& device, int framesInFlight, VkDeviceSize capacity = DEFAULT_CAPACITY,
+		VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	FrameAllocator(const FrameAllocator&) = delete;
+	FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+	// Throws when the frame's buffer is full
+	Allocation allocate(int frameIndex, VkDeviceSize size);
+
+	// Copies data into a new allocation and returns its dynamic offset
+	template<typename T>
+	uint32_t push(int frameIndex, const T& data)
+	{
+		Allocation allocation = allocate(frameIndex, sizeof(T));
+		*static_cast<T*>(allocation.data) = data;
+		return allocation.offset;
+	}
+
+	// Makes everything allocated this frame visible to the GPU, call before submitting the frame
+	void flush(int frameIndex);
+	void reset(int frameIndex) { m_offsets[frameIndex].store(0); }
+
+	VkBuffer getBuffer(int frameIndex) const { return m_buffers[frameIndex]->getBuffer(); }
+	VkDeviceSize getUsedSize(int frameIndex) const { return m_offsets[frameIndex].load(); }
+	VkDeviceSize getCapacity() const { return m_capacity; }
+
+	// For a dynamic uniform or storage buffer descriptor, range is the size that gets bound at every dynamic offset
+	VkDescriptorBufferInfo descriptorInfo(int frameIndex, VkDeviceSize range) const;
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Camera.h"
+#include "Renderer.h"
+#include "FrameAllocator.h"
 
 #include <vulkan/vulkan.h>
 
@@ -11,4 +13,9 @@ struct FrameInfo
 	VkCommandBuffer commandBuffer;
 	Camera& camera;
 	VkDescriptorSet globalDescriptorSet;
+	// Dynamic offset of the global ubo in globalDescriptorSet
+	uint32_t globalUboOffset;
+	Renderer& renderer;
+	// For any other data that is only needed this frame
+	FrameAllocator& frameAllocator;
 };
\ No newline at end of file
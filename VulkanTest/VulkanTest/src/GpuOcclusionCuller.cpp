@@ -0,0 +1,568 @@
+#include "GpuOcclusionCuller.h"
+#include "SwapChain.h"
+
+#include <stdexcept>
+#include <cassert>
+#include <algorithm>
+#include <array>
+
+// Matches Push in cull.comp
+struct CullPushConstantData
+{
+	glm::mat4 viewProjection{ 1.0f };
+	glm::vec2 pyramidSize{};
+	uint32_t drawCount = 0;
+	uint32_t phase = 0;
+	uint32_t pyramidLevels = 0;
+};
+
+// Matches Push in depth_reduce.comp
+struct ReducePushConstantData
+{
+	glm::uvec2 sourceSize{};
+	glm::uvec2 destinationSize{};
+};
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+static uint32_t PreviousPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result * 2 <= value)
+	{
+		result *= 2;
+	}
+
+	return result;
+}
+
+static VkImageAspectFlags GetDepthAspectMask(VkFormat format)
+{
+	// Layout transitions of combined depth stencil formats have to include both aspects
+	bool hasStencil = format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+	return hasStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+GpuOcclusionCuller::GpuOcclusionCuller(Device& device, int framesInFlight, uint32_t maxObjects, uint32_t maxDraws)
+	: m_device(device), m_framesInFlight(framesInFlight), m_maxDraws(maxDraws), m_maxObjects(maxObjects)
+{
+	if (!m_device.enabledFeatures.drawIndirectFirstInstance)
+	{
+		throw std::runtime_error("Failed to create GPU occlusion culler: drawIndirectFirstInstance is not supported");
+	}
+
+	createBuffers();
+	createPipelines();
+	createSampler();
+}
+
+GpuOcclusionCuller::~GpuOcclusionCuller()
+{
+	destroyDepthPyramid();
+
+	VkSampler sampler = m_sampler;
+	VkPipelineLayout cullPipelineLayout = m_cullPipelineLayout;
+	VkPipelineLayout reducePipelineLayout = m_reducePipelineLayout;
+	m_device.destroyDeferred([sampler, cullPipelineLayout, reducePipelineLayout](VkDevice device)
+	{
+		vkDestroySampler(device, sampler, nullptr);
+		vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(device, reducePipelineLayout, nullptr);
+	});
+}
+
+VkBuffer GpuOcclusionCuller::getDrawCommands(int frameIndex, Phase phase) const
+{
+	return phase == Phase::Early ? m_earlyCommandBuffers[frameIndex]->getBuffer() : m_lateCommandBuffers[frameIndex]->getBuffer();
+}
+
+void GpuOcclusionCuller::createBuffers()
+{
+	m_cullObjectBuffers.resize(m_framesInFlight);
+	m_earlyCommandBuffers.resize(m_framesInFlight);
+	m_lateCommandBuffers.resize(m_framesInFlight);
+
+	for (int i = 0; i < m_framesInFlight; i++)
+	{
+		m_cullObjectBuffers[i] = std::make_unique<Buffer>
+		(
+			m_device,
+			sizeof(CullObject),
+			m_maxDraws,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		);
+
+		m_cullObjectBuffers[i]->map();
+
+		// Only ever written by the cull shader
+		m_earlyCommandBuffers[i] = std::make_unique<Buffer>
+		(
+			m_device,
+			DRAW_COMMAND_STRIDE,
+			m_maxDraws,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+
+		m_lateCommandBuffers[i] = std::make_unique<Buffer>
+		(
+			m_device,
+			DRAW_COMMAND_STRIDE,
+			m_maxDraws,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+	}
+
+	m_visibilityBuffer = std::make_unique<Buffer>
+	(
+		m_device,
+		sizeof(uint32_t),
+		m_maxObjects,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+}
+
+void GpuOcclusionCuller::createPipelines()
+{
+	m_cullSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+
+	m_reduceSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+
+	auto createLayout = [this](VkDescriptorSetLayout setLayout, uint32_t pushConstantSize)
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = pushConstantSize;
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		VkPipelineLayout pipelineLayout;
+		VkResult result = vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create pipeline layout");
+		}
+
+		return pipelineLayout;
+	};
+
+	m_cullPipelineLayout = createLayout(m_cullSetLayout->getDescriptorSetLayout(), sizeof(CullPushConstantData));
+	m_reducePipelineLayout = createLayout(m_reduceSetLayout->getDescriptorSetLayout(), sizeof(ReducePushConstantData));
+
+	m_cullPipeline = std::make_unique<ComputePipeline>(m_device, "shaders/cull.comp.spv", m_cullPipelineLayout);
+	m_reducePipeline = std::make_unique<ComputePipeline>(m_device, "shaders/depth_reduce.comp.spv", m_reducePipelineLayout);
+}
+
+void GpuOcclusionCuller::createSampler()
+{
+	// Only used with texelFetch, the farthest depth of a region is found by the shaders themselves
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	VkResult result = vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create depth pyramid sampler");
+	}
+}
+
+void GpuOcclusionCuller::createDepthPyramid(Renderer& renderer)
+{
+	// The old pyramid and descriptor sets might still be used by frames in flight, so they are destroyed deferred
+	destroyDepthPyramid();
+
+	VkExtent2D extent = renderer.getSwapChainExtent();
+	m_pyramidWidth = PreviousPowerOfTwo(extent.width);
+	m_pyramidHeight = PreviousPowerOfTwo(extent.height);
+
+	m_pyramidLevels = 1;
+	while ((std::max(m_pyramidWidth, m_pyramidHeight) >> m_pyramidLevels) > 0)
+	{
+		m_pyramidLevels++;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = m_pyramidWidth;
+	imageInfo.extent.height = m_pyramidHeight;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = m_pyramidLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	m_device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pyramidImage, m_pyramidMemory);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_pyramidImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = m_pyramidLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	VkResult result = vkCreateImageView(m_device.device(), &viewInfo, nullptr, &m_pyramidView);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create depth pyramid image view");
+	}
+
+	m_pyramidLevelViews.resize(m_pyramidLevels);
+	for (uint32_t level = 0; level < m_pyramidLevels; level++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		result = vkCreateImageView(m_device.device(), &viewInfo, nullptr, &m_pyramidLevelViews[level]);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create depth pyramid image view");
+		}
+	}
+
+	// The cull shader always has the pyramid bound, so it has to be in its layout before the first one gets built
+	VkCommandBuffer commandBuffer = m_device.beginSingleTimeCommands();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_pyramidImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevels, 0, 1 };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	m_device.endSingleTimeCommands(commandBuffer);
+
+	createDescriptorSets(renderer);
+	m_swapChainVersion = renderer.getSwapChainVersion();
+}
+
+void GpuOcclusionCuller::destroyDepthPyramid()
+{
+	m_cullDescriptorSets.clear();
+	m_depthReduceDescriptorSets.clear();
+	m_levelReduceDescriptorSets.clear();
+	m_descriptorPool = nullptr;
+
+	if (m_pyramidImage == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::vector<VkImageView> levelViews = std::move(m_pyramidLevelViews);
+	VkImageView view = m_pyramidView;
+	VkImage image = m_pyramidImage;
+	VkDeviceMemory memory = m_pyramidMemory;
+	m_device.destroyDeferred([levelViews, view, image, memory](VkDevice device)
+	{
+		for (VkImageView levelView : levelViews)
+		{
+			vkDestroyImageView(device, levelView, nullptr);
+		}
+
+		vkDestroyImageView(device, view, nullptr);
+		vkDestroyImage(device, image, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+	});
+
+	m_pyramidLevelViews.clear();
+	m_pyramidImage = VK_NULL_HANDLE;
+}
+
+void GpuOcclusionCuller::createDescriptorSets(Renderer& renderer)
+{
+	uint32_t imageCount = renderer.getSwapChainImageCount();
+	uint32_t reduceSetCount = imageCount + m_pyramidLevels - 1;
+
+	m_descriptorPool = DescriptorPool::Builder(m_device)
+		.setMaxSets(m_framesInFlight + reduceSetCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_framesInFlight * 4)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_framesInFlight + reduceSetCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, reduceSetCount)
+		.build();
+
+	VkDescriptorBufferInfo visibilityInfo = m_visibilityBuffer->descriptorInfo();
+	VkDescriptorImageInfo pyramidInfo{ m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+
+	m_cullDescriptorSets.resize(m_framesInFlight);
+	for (int i = 0; i < m_framesInFlight; i++)
+	{
+		VkDescriptorBufferInfo cullObjectInfo = m_cullObjectBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo earlyCommandInfo = m_earlyCommandBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo lateCommandInfo = m_lateCommandBuffers[i]->descriptorInfo();
+
+		DescriptorWriter(*m_cullSetLayout, *m_descriptorPool)
+			.writeBuffer(0, &cullObjectInfo)
+			.writeBuffer(1, &earlyCommandInfo)
+			.writeBuffer(2, &lateCommandInfo)
+			.writeBuffer(3, &visibilityInfo)
+			.writeImage(4, &pyramidInfo)
+			.build(m_cullDescriptorSets[i]);
+	}
+
+	// The first level reads the depth buffer of the swap chain image that is being rendered to
+	VkDescriptorImageInfo firstLevelInfo{ VK_NULL_HANDLE, m_pyramidLevelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+
+	m_depthReduceDescriptorSets.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		VkDescriptorImageInfo depthInfo{ m_sampler, renderer.getDepthImageView(i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+		DescriptorWriter(*m_reduceSetLayout, *m_descriptorPool)
+			.writeImage(0, &depthInfo)
+			.writeImage(1, &firstLevelInfo)
+			.build(m_depthReduceDescriptorSets[i]);
+	}
+
+	m_levelReduceDescriptorSets.resize(m_pyramidLevels - 1);
+	for (uint32_t level = 1; level < m_pyramidLevels; level++)
+	{
+		VkDescriptorImageInfo sourceInfo{ m_sampler, m_pyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+		VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, m_pyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+		DescriptorWriter(*m_reduceSetLayout, *m_descriptorPool)
+			.writeImage(0, &sourceInfo)
+			.writeImage(1, &destinationInfo)
+			.build(m_levelReduceDescriptorSets[level - 1]);
+	}
+}
+
+void GpuOcclusionCuller::cullEarly(FrameInfo& frameInfo, uint32_t drawCount, const glm::mat4& viewProjection)
+{
+	assert(drawCount <= m_maxDraws && "Cannot cull more objects than the cull object buffer can hold");
+
+	if (m_swapChainVersion != frameInfo.renderer.getSwapChainVersion())
+	{
+		createDepthPyramid(frameInfo.renderer);
+	}
+
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+	if (!m_visibilityCleared)
+	{
+		// Nothing was visible before the first frame, so that one draws everything in the late phase
+		vkCmdFillBuffer(commandBuffer, m_visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+		m_visibilityCleared = true;
+	}
+
+	// The visibility was written by the late phase of the last frame (or cleared just now)
+	VkMemoryBarrier visibilityBarrier{};
+	visibilityBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	visibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1,
+		&visibilityBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+
+	m_cullObjectBuffers[frameInfo.frameIndex]->flush();
+	dispatchCull(frameInfo, Phase::Early, drawCount, viewProjection);
+}
+
+void GpuOcclusionCuller::cullLate(FrameInfo& frameInfo, uint32_t drawCount, const glm::mat4& viewProjection)
+{
+	assert(drawCount <= m_maxDraws && "Cannot cull more objects than the cull object buffer can hold");
+	assert(m_swapChainVersion == frameInfo.renderer.getSwapChainVersion() && "Cannot cull the late phase without the early phase");
+
+	buildDepthPyramid(frameInfo);
+	dispatchCull(frameInfo, Phase::Late, drawCount, viewProjection);
+
+	// Give the depth back to the render pass that draws the late commands
+	VkImageMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = frameInfo.renderer.getDepthImage(frameInfo.renderer.getCurrentImageIndex());
+	depthBarrier.subresourceRange = { GetDepthAspectMask(frameInfo.renderer.getDepthFormat()), 0, 1, 0, 1 };
+	depthBarrier.srcAccessMask = 0;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&depthBarrier);
+}
+
+void GpuOcclusionCuller::dispatchCull(FrameInfo& frameInfo, Phase phase, uint32_t drawCount, const glm::mat4& viewProjection)
+{
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+	if (drawCount > 0)
+	{
+		m_cullPipeline->bind(commandBuffer);
+
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			m_cullPipelineLayout,
+			0,
+			1,
+			&m_cullDescriptorSets[frameInfo.frameIndex],
+			0,
+			nullptr);
+
+		CullPushConstantData push{};
+		push.viewProjection = viewProjection;
+		push.pyramidSize = glm::vec2(m_pyramidWidth, m_pyramidHeight);
+		push.drawCount = drawCount;
+		push.phase = static_cast<uint32_t>(phase);
+		push.pyramidLevels = m_pyramidLevels;
+
+		vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &push);
+		vkCmdDispatch(commandBuffer, (drawCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	// The late phase also wrote the visibility, which the next frame reads (that one has its own barrier for it)
+	VkMemoryBarrier commandBarrier{};
+	commandBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	commandBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	commandBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0,
+		1,
+		&commandBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+}
+
+void GpuOcclusionCuller::buildDepthPyramid(FrameInfo& frameInfo)
+{
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+	uint32_t imageIndex = frameInfo.renderer.getCurrentImageIndex();
+
+	// The depth goes from being written by the render pass to being sampled, the old pyramid contents are
+	// discarded (they were last read by the late phase of the previous frame)
+	std::array<VkImageMemoryBarrier, 2> barriers{};
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = frameInfo.renderer.getDepthImage(imageIndex);
+	barriers[0].subresourceRange = { GetDepthAspectMask(frameInfo.renderer.getDepthFormat()), 0, 1, 0, 1 };
+	barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].image = m_pyramidImage;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevels, 0, 1 };
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(barriers.size()),
+		barriers.data());
+
+	m_reducePipeline->bind(commandBuffer);
+
+	VkExtent2D depthExtent = frameInfo.renderer.getSwapChainExtent();
+	glm::uvec2 sourceSize{ depthExtent.width, depthExtent.height };
+
+	for (uint32_t level = 0; level < m_pyramidLevels; level++)
+	{
+		VkDescriptorSet descriptorSet = level == 0 ? m_depthReduceDescriptorSets[imageIndex] : m_levelReduceDescriptorSets[level - 1];
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_reducePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+		ReducePushConstantData push{};
+		push.sourceSize = sourceSize;
+		push.destinationSize = glm::uvec2(std::max(m_pyramidWidth >> level, 1u), std::max(m_pyramidHeight >> level, 1u));
+
+		vkCmdPushConstants(commandBuffer, m_reducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstantData), &push);
+		vkCmdDispatch(
+			commandBuffer,
+			(push.destinationSize.x + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+			(push.destinationSize.y + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+			1);
+
+		// The next level (or the cull shader) reads this one
+		VkImageMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelBarrier.image = m_pyramidImage;
+		levelBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+		sourceSize = push.destinationSize;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+#include "Descriptor.h"
+#include "Pipeline.h"
+#include "FrameInfo.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// Two-phase occlusion culling on the GPU against a hierarchical depth buffer, without reading anything back.
+// Every frame the frustum visible objects are written as cull objects, then:
+//  - cullEarly writes draw commands for the objects that were visible at the end of the last frame
+//  - those get drawn, after which cullLate builds a depth pyramid (every level keeps the farthest depth) from the
+//    stored depth, tests every object against it and writes draw commands for the ones that only became visible
+//  - those get drawn in a second render pass that continues on the first one
+// The draw commands are one per cull object with an instance count of 0 or 1, with the object index as the first
+// instance so the vertex shader can find the object data in gl_InstanceIndex
+class GpuOcclusionCuller
+{
+public:
+	// Matches CullObject in cull.comp, the bounds are in world space
+	struct CullObject
+	{
+		glm::vec3 boundsMin;
+		uint32_t objectIndex;
+		glm::vec3 boundsMax;
+		uint32_t count;  // Index count for indexed models, vertex count otherwise
+		uint32_t indexed;
+		uint32_t padding[3];
+	};
+
+	enum class Phase : uint32_t
+	{
+		Early = 0,
+		Late = 1
+	};
+
+	// Indexed and non-indexed draw commands share the same stride
+	static constexpr uint32_t DRAW_COMMAND_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+
+private:
+	Device& m_device;
+	int m_framesInFlight;
+	uint32_t m_maxDraws;
+	uint32_t m_maxObjects;
+
+	// One of each for every frame in flight
+	std::vector<std::unique_ptr<Buffer>> m_cullObjectBuffers;
+	std::vector<std::unique_ptr<Buffer>> m_earlyCommandBuffers;
+	std::vector<std::unique_ptr<Buffer>> m_lateCommandBuffers;
+
+	// Visibility of every object at the end of the last frame, cleared on the first use
+	std::unique_ptr<Buffer> m_visibilityBuffer;
+	bool m_visibilityCleared = false;
+
+	std::unique_ptr<DescriptorSetLayout> m_cullSetLayout;
+	VkPipelineLayout m_cullPipelineLayout;
+	std::unique_ptr<ComputePipeline> m_cullPipeline;
+
+	std::unique_ptr<DescriptorSetLayout> m_reduceSetLayout;
+	VkPipelineLayout m_reducePipelineLayout;
+	std::unique_ptr<ComputePipeline> m_reducePipeline;
+
+	VkSampler m_sampler;
+
+	// The pyramid is a power of two (rounded down from the swap chain extent) and gets recreated together with the
+	// swap chain. It stays in the general layout so it can be written level by level and sampled as a whole
+	VkImage m_pyramidImage = VK_NULL_HANDLE;
+	VkDeviceMemory m_pyramidMemory = VK_NULL_HANDLE;
+	VkImageView m_pyramidView = VK_NULL_HANDLE;
+	std::vector<VkImageView> m_pyramidLevelViews;
+	uint32_t m_pyramidWidth = 0;
+	uint32_t m_pyramidHeight = 0;
+	uint32_t m_pyramidLevels = 0;
+	uint32_t m_swapChainVersion = 0;
+
+	// All sets reference the pyramid or the swap chain, so they are allocated again when those change
+	std::unique_ptr<DescriptorPool> m_descriptorPool;
+	std::vector<VkDescriptorSet> m_cullDescriptorSets;
+	std::vector<VkDescriptorSet> m_depthReduceDescriptorSets;
+	std::vector<VkDescriptorSet> m_levelReduceDescriptorSets;
+
+public:
+	// Needs the drawIndirectFirstInstance device feature. maxObjects is the range of the object indices,
+	// maxDraws the amount of cull objects per frame
+	GpuOcclusionCuller(Device& device, int framesInFlight, uint32_t maxObjects, uint32_t maxDraws);
+	~GpuOcclusionCuller();
+
+	GpuOcclusionCuller(const GpuOcclusionCuller&) = delete;
+	GpuOcclusionCuller& operator=(const GpuOcclusionCuller&) = delete;
+
+	uint32_t getMaxDraws() const { return m_maxDraws; }
+
+	// Mapped array of getMaxDraws() cull objects for the frame, filled in before cullEarly
+	CullObject* getCullObjects(int frameIndex) const { return static_cast<CullObject*>(m_cullObjectBuffers[frameIndex]->getMappedMemory()); }
+
+	// Draw command i belongs to cull object i, with DRAW_COMMAND_STRIDE between them
+	VkBuffer getDrawCommands(int frameIndex, Phase phase) const;
+
+	// Both have to be recorded outside of a render pass. cullLate reads the depth of the render pass that drew the
+	// early commands and hands it back for the render pass that draws the late ones
+	void cullEarly(FrameInfo& frameInfo, uint32_t drawCount, const glm::mat4& viewProjection);
+	void cullLate(FrameInfo& frameInfo, uint32_t drawCount, const glm::mat4& viewProjection);
+
+private:
+	void createBuffers();
+	void createPipelines();
+	void createSampler();
+	void createDepthPyramid(Renderer& renderer);
+	void destroyDepthPyramid();
+	void createDescriptorSets(Renderer& renderer);
+
+	void dispatchCull(FrameInfo& frameInfo, Phase phase, uint32_t drawCount, const glm::mat4& viewProjection);
+	void buildDepthPyramid(FrameInfo& frameInfo);
+};
\ No newline at end of file
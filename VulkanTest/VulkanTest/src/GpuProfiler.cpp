@@ -0,0 +1,263 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkQueryPool CreateTimestampQueryPool(Device& device, uint32_t queryCount)
+{
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = queryCount;
+
+	VkQueryPool queryPool;
+	if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create timestamp query pool");
+	}
+
+	return queryPool;
+}
+
+double GpuProfiler::PassStats::getAverageMs() const
+{
+	if (history.empty())
+	{
+		return 0.0;
+	}
+
+	double totalMs = 0.0;
+	for (double ms : history)
+	{
+		totalMs += ms;
+	}
+
+	return totalMs / history.size();
+}
+
+GpuProfiler::Scope::Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name):
+	m_profiler(profiler), m_commandBuffer(commandBuffer), m_scope(INVALID_SCOPE)
+{
+	if (m_profiler != nullptr)
+	{
+		m_scope = m_profiler->beginScope(m_commandBuffer, name);
+	}
+}
+
+GpuProfiler::Scope::~Scope()
+{
+	if (m_profiler != nullptr)
+	{
+		m_profiler->endScope(m_commandBuffer, m_scope);
+	}
+}
+
+GpuProfiler::GpuProfiler(Device& device, int framesInFlight, uint32_t maxScopes): m_device(device), m_maxScopes(maxScopes)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_device.getPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_device.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[m_device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+	m_supported = validBits > 0;
+	m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	m_timestampPeriod = m_device.properties.limits.timestampPeriod;
+
+	m_frameScopes.resize(framesInFlight);
+	if (!m_supported)
+	{
+		return;
+	}
+
+	m_queryPools.resize(framesInFlight);
+	for (auto& queryPool : m_queryPools)
+	{
+		queryPool = CreateTimestampQueryPool(m_device, m_maxScopes * 2);
+	}
+
+	m_uploadQueryPool = CreateTimestampQueryPool(m_device, 2);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	// The last frames might still write their timestamps
+	std::vector<VkQueryPool> queryPools = m_queryPools;
+	queryPools.push_back(m_uploadQueryPool);
+	m_device.destroyDeferred([queryPools](VkDevice device)
+	{
+		for (VkQueryPool queryPool : queryPools)
+		{
+			vkDestroyQueryPool(device, queryPool, nullptr);
+		}
+	});
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex)
+{
+	m_currentFrameIndex = frameIndex;
+	if (!m_supported)
+	{
+		return;
+	}
+
+	collectFrame(frameIndex);
+	vkCmdResetQueryPool(commandBuffer, m_queryPools[frameIndex], 0, m_maxScopes * 2);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!m_supported || m_currentFrameIndex < 0)
+	{
+		return INVALID_SCOPE;
+	}
+
+	auto& scopes = m_frameScopes[m_currentFrameIndex];
+	if (scopes.size() >= m_maxScopes)
+	{
+		return INVALID_SCOPE;
+	}
+
+	uint32_t scope = static_cast<uint32_t>(scopes.size());
+	scopes.push_back(FrameScope{ name, scope * 2 });
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPools[m_currentFrameIndex], scope * 2);
+
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+	if (scope == INVALID_SCOPE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPools[m_currentFrameIndex], scope * 2 + 1);
+}
+
+void GpuProfiler::beginUpload(VkCommandBuffer commandBuffer)
+{
+	if (!m_supported)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, m_uploadQueryPool, 0, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_uploadQueryPool, 0);
+}
+
+void GpuProfiler::endUpload(VkCommandBuffer commandBuffer)
+{
+	if (!m_supported)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_uploadQueryPool, 1);
+}
+
+void GpuProfiler::collectUpload()
+{
+	if (!m_supported)
+	{
+		return;
+	}
+
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(m_device.device(), m_uploadQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result == VK_SUCCESS)
+	{
+		addSample("Upload", timestamps[0], timestamps[1]);
+	}
+}
+
+void GpuProfiler::collectFrame(int frameIndex)
+{
+	auto& scopes = m_frameScopes[frameIndex];
+	if (scopes.empty())
+	{
+		return;
+	}
+
+	// Without the wait bit, a frame that somehow isn't done yet is skipped instead of stalling
+	std::vector<uint64_t> timestamps(scopes.size() * 2);
+	VkResult result = vkGetQueryPoolResults(
+		m_device.device(),
+		m_queryPools[frameIndex],
+		0,
+		static_cast<uint32_t>(timestamps.size()),
+		timestamps.size() * sizeof(uint64_t),
+		timestamps.data(),
+		sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT);
+
+	if (result == VK_SUCCESS)
+	{
+		for (const FrameScope& scope : scopes)
+		{
+			addSample(scope.name, timestamps[scope.firstQuery], timestamps[scope.firstQuery + 1]);
+		}
+	}
+
+	scopes.clear();
+}
+
+void GpuProfiler::addSample(const char* name, uint64_t beginTimestamp, uint64_t endTimestamp)
+{
+	double ms = static_cast<double>((endTimestamp - beginTimestamp) & m_timestampMask) * m_timestampPeriod / 1000000.0;
+
+	auto it = m_passIndices.find(name);
+	if (it == m_passIndices.end())
+	{
+		it = m_passIndices.emplace(name, m_passStats.size()).first;
+		m_passStats.emplace_back();
+		m_passStats.back().name = name;
+		m_passStats.back().minMs = ms;
+		m_passStats.back().maxMs = ms;
+	}
+
+	PassStats& stats = m_passStats[it->second];
+	stats.lastMs = ms;
+	stats.minMs = std::min(stats.minMs, ms);
+	stats.maxMs = std::max(stats.maxMs, ms);
+	stats.sampleCount++;
+
+	if (m_keepAllSamples)
+	{
+		stats.samples.push_back(ms);
+	}
+
+	if (stats.history.size() < AVERAGE_FRAME_COUNT)
+	{
+		stats.history.push_back(ms);
+	}
+	else
+	{
+		stats.history[stats.historyIndex] = ms;
+		stats.historyIndex = (stats.historyIndex + 1) % AVERAGE_FRAME_COUNT;
+	}
+}
+
+void GpuProfiler::writeCsv(std::ostream& stream) const
+{
+	stream << "pass,average_ms,last_ms,min_ms,max_ms,samples\n";
+	for (const PassStats& stats : m_passStats)
+	{
+		stream << stats.name << "," << stats.getAverageMs() << "," << stats.lastMs << "," << stats.minMs << ","
+			<< stats.maxMs << "," << stats.sampleCount << "\n";
+	}
+}
+
+void GpuProfiler::writeJson(std::ostream& stream) const
+{
+	stream << "{\n\t\"passes\": [";
+	for (size_t i = 0; i < m_passStats.size(); i++)
+	{
+		const PassStats& stats = m_passStats[i];
+		stream << (i == 0 ? "\n" : ",\n") << "\t\t{ \"name\": \"" << stats.name << "\", \"averageMs\": " << stats.getAverageMs()
+			<< ", \"lastMs\": " << stats.lastMs << ", \"minMs\": " << stats.minMs << ", \"maxMs\": " << stats.maxMs
+			<< ", \"samples\": " << stats.sampleCount << " }";
+	}
+	stream << "\n\t]\n}\n";
+}
\ No newline at end of file
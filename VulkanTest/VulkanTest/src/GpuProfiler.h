@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Device.h"
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Measures how long passes take on the GPU with timestamp queries. Every frame in flight has its own query pool, which
+// is read back (without waiting) the next time the frame index comes around, so the GPU is long done with it by then.
+// Single time (upload) commands are measured as well when the profiler is set on the device
+class GpuProfiler
+{
+public:
+	// Rolling average over the last AVERAGE_FRAME_COUNT samples of a pass
+	static constexpr uint32_t AVERAGE_FRAME_COUNT = 60;
+	static constexpr uint32_t DEFAULT_MAX_SCOPES = 64;
+
+	struct PassStats
+	{
+		std::string name;
+		double lastMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+		uint64_t sampleCount = 0;
+
+		std::vector<double> history;
+		uint32_t historyIndex = 0;
+
+		// Every sample since the start, only kept with setKeepAllSamples
+		std::vector<double> samples;
+
+		double getAverageMs() const;
+	};
+
+	// Writes both timestamps of a scope for the lifetime of the object, does nothing without a profiler
+	class Scope
+	{
+	private:
+		GpuProfiler* m_profiler;
+		VkCommandBuffer m_commandBuffer;
+		uint32_t m_scope;
+
+	public:
+		Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+private:
+	struct FrameScope
+	{
+		const char* name;
+		uint32_t firstQuery;
+	};
+
+	Device& m_device;
+	uint32_t m_maxScopes;
+	bool m_supported;
+	double m_timestampPeriod;
+	uint64_t m_timestampMask;
+
+	// One pool with two queries per scope for every frame in flight
+	std::vector<VkQueryPool> m_queryPools;
+	std::vector<std::vector<FrameScope>> m_frameScopes;
+	int m_currentFrameIndex = -1;
+
+	// Single time commands are waited on anyway, so their pool is read back right after
+	VkQueryPool m_uploadQueryPool = VK_NULL_HANDLE;
+
+	bool m_keepAllSamples = false;
+	std::vector<PassStats> m_passStats;
+	std::unordered_map<std::string, size_t> m_passIndices;
+
+public:
+	// Needs a graphics queue that supports timestamps, otherwise every scope is ignored
+	GpuProfiler(Device& device, int framesInFlight, uint32_t maxScopes = DEFAULT_MAX_SCOPES);
+	~GpuProfiler();
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	bool isSupported() const { return m_supported; }
+
+	// Reads back the timings of the last time this frame index was used and resets its queries. Has to be recorded
+	// first thing in the frame (outside of a render pass), after Renderer::beginFrame
+	void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+	// Returns INVALID_SCOPE when the frame has no queries left
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+	// Called by the device around its single time commands
+	void beginUpload(VkCommandBuffer commandBuffer);
+	void endUpload(VkCommandBuffer commandBuffer);
+	void collectUpload();
+
+	const std::vector<PassStats>& getPassStats() const { return m_passStats; }
+	// For reports that need more than the rolling averages, like percentiles
+	void setKeepAllSamples(bool keep) { m_keepAllSamples = keep; }
+
+	void writeCsv(std::ostream& stream) const;
+	void writeJson(std::ostream& stream) const;
+
+private:
+	void collectFrame(int frameIndex);
+	void addSample(const char* name, uint64_t beginTimestamp, uint64_t endTimestamp);
+};
\ No newline at end of file
@@ -1,8 +1,18 @@
 #include "KeyboardMovementController.h"
 
+#include <glm/gtc/constants.hpp>
+
 #include <limits>
 
-void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float delta, GameObject& gameObject)
+void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float delta, Registry& registry, TransformSystem& transformSystem)
+{
+	registry.each<KeyboardControlComponent, TransformHandleComponent>([&](Entity, KeyboardControlComponent&, TransformHandleComponent& transform)
+	{
+		moveInPlaneXZ(window, delta, transformSystem, transform.transformId);
+	});
+}
+
+void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float delta, TransformSystem& transformSystem, TransformSystem::id_t transformId)
 {
 	glm::vec3 rotate{ 0 };
 
@@ -11,15 +21,18 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float delta,
 	if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.0f;
 	if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.0f;
 
+	glm::vec3 rotation = transformSystem.getRotation(transformId);
+
 	if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
 	{
-		gameObject.transform.rotation += lookSpeed * delta * glm::normalize(rotate);
+		rotation += lookSpeed * delta * glm::normalize(rotate);
 	}
 
-	gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-	gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+	rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+	rotation.y = glm::mod(rotation.y, glm::two_pi<float>());
+	transformSystem.setRotation(transformId, rotation);
 
-	float yaw = gameObject.transform.rotation.y;
+	float yaw = rotation.y;
 	const glm::vec3 forwardDir{ sin(yaw), 0.0f, cos(yaw) };
 	const glm::vec3 rightDir{ forwardDir.z, 0.0f, -forwardDir.x };
 	const glm::vec3 upDir{ 0.0f, -1.0f, 0.0f };
@@ -34,6 +47,6 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float delta,
 
 	if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
 	{
-		gameObject.transform.translation += moveSpeed * delta * glm::normalize(moveDir);
+		transformSystem.setTranslation(transformId, transformSystem.getTranslation(transformId) + moveSpeed * delta * glm::normalize(moveDir));
 	}
 }
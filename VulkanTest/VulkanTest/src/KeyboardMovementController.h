@@ -1,6 +1,8 @@
 #pragma once
 
-#include "GameObject.h"
+#include "Registry.h"
+#include "Components.h"
+#include "TransformSystem.h"
 #include "Window.h"
 
 class KeyboardMovementController
@@ -20,7 +22,9 @@ public:
         int lookDown = GLFW_KEY_DOWN;
 	};
 
-    void moveInPlaneXZ(GLFWwindow* window, float delta, GameObject& gameObject);
+    // Moves every entity that has a KeyboardControlComponent
+    void moveInPlaneXZ(GLFWwindow* window, float delta, Registry& registry, TransformSystem& transformSystem);
+    void moveInPlaneXZ(GLFWwindow* window, float delta, TransformSystem& transformSystem, TransformSystem::id_t transformId);
 
     KeyMappings keys{};
     float moveSpeed{ 3.0f };
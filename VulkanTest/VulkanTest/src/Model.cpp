@@ -2,33 +2,17 @@
 
 #include <cassert>
 #include <cstring>
-#include <unordered_map>
-
-#include "Utils.h"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "../libs/TinyObjLoader.h"
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
-namespace std
-{
-	template<>
-	struct hash<Model::Vertex>
-	{
-		size_t operator()(Model::Vertex const& vertex) const
-		{
-			size_t seed = 0;
-			HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
 
 Model::Model(Device& device, const Data& data): m_device(device)
 {
 	createVertexBuffer(data.vertices);
+	createPositionBuffer(data.vertices);
 	createIndexBuffer(data.indices);
+
+	for (const auto& vertex : data.vertices)
+	{
+		m_bounds.expand(vertex.position);
+	}
 }
 
 Model::~Model()
@@ -59,6 +43,19 @@ void Model::bind(VkCommandBuffer commandBuffer)
 	}
 }
 
+void Model::bindPositions(VkCommandBuffer commandBuffer)
+{
+	VkBuffer buffers[] = { m_positionBuffer->getBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+	if (m_hasIndexBuffer)
+	{
+		vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+}
+
 void Model::draw(VkCommandBuffer commandBuffer)
 {
 	if (m_hasIndexBuffer)
@@ -70,6 +67,26 @@ void Model::draw(VkCommandBuffer commandBuffer)
 	}
 }
 
+void Model::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+	// Without multiDrawIndirect every command needs its own call
+	uint32_t callCount = m_device.enabledFeatures.multiDrawIndirect ? 1 : drawCount;
+	uint32_t commandsPerCall = m_device.enabledFeatures.multiDrawIndirect ? drawCount : 1;
+
+	for (uint32_t i = 0; i < callCount; i++)
+	{
+		VkDeviceSize callOffset = offset + static_cast<VkDeviceSize>(i) * stride;
+
+		if (m_hasIndexBuffer)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, callOffset, commandsPerCall, stride);
+		} else
+		{
+			vkCmdDrawIndirect(commandBuffer, buffer, callOffset, commandsPerCall, stride);
+		}
+	}
+}
+
 void Model::createVertexBuffer(const std::vector<Vertex>& vertices)
 {
 	m_vertexCount = static_cast<uint32_t>(vertices.size());
@@ -107,6 +124,41 @@ void Model::createVertexBuffer(const std::vector<Vertex>& vertices)
 	m_device.copyBuffer(stagingBuffer.getBuffer(), m_vertexBuffer->getBuffer(), bufferSize);
 }
 
+void Model::createPositionBuffer(const std::vector<Vertex>& vertices)
+{
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		positions[i] = vertices[i].position;
+	}
+
+	VkDeviceSize bufferSize = sizeof(positions[0]) * m_vertexCount;
+	uint32_t positionSize = sizeof(positions[0]);
+
+	Buffer stagingBuffer
+	{
+		m_device,
+		positionSize,
+		m_vertexCount,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+	};
+
+	stagingBuffer.map();
+	stagingBuffer.writeToBuffer((void*) positions.data());
+
+	m_positionBuffer = std::make_unique<Buffer>
+	(
+		m_device,
+		positionSize,
+		m_vertexCount,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	m_device.copyBuffer(stagingBuffer.getBuffer(), m_positionBuffer->getBuffer(), bufferSize);
+}
+
 void Model::createIndexBuffer(const std::vector<uint32_t>& indices)
 {
 	m_indexCount = static_cast<uint32_t>(indices.size());
@@ -187,72 +239,24 @@ std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescri
 	return attributeDescriptions;
 }
 
-void Model::Data::loadModel(const std::string& filePath)
+std::vector<VkVertexInputBindingDescription> Model::Vertex::getPositionBindingDescriptions()
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, error;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(glm::vec3);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &error, filePath.c_str()))
-	{
-		throw std::runtime_error(warn + error);
-	}
+	return bindingDescriptions;
+}
 
-	vertices.clear();
-	indices.clear();
+std::vector<VkVertexInputAttributeDescription> Model::Vertex::getPositionAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[0].offset = 0;
 
-	for (const auto& shape : shapes)
-	{
-		for (const auto& index : shape.mesh.indices)
-		{
-			Vertex vertex{};
-
-			if (index.vertex_index >= 0)
-			{
-				vertex.position =
-				{
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2],
-				};
-
-				vertex.color =
-				{
-					attrib.colors[3 * index.vertex_index + 0],
-					attrib.colors[3 * index.vertex_index + 1],
-					attrib.colors[3 * index.vertex_index + 2],
-				};
-			}
-
-			if (index.normal_index >= 0)
-			{
-				vertex.normal =
-				{
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2],
-				};
-			}
-
-			if (index.texcoord_index >= 0)
-			{
-				vertex.uv =
-				{
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1],
-				};
-			}
-
-			if (uniqueVertices.count(vertex) == 0)
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
-
-			indices.push_back(uniqueVertices[vertex]);
-		}
-	}
-}
+	return attributeDescriptions;
+}
\ No newline at end of file
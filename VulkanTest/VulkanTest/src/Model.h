@@ -2,10 +2,15 @@
 
 #include "Device.h"
 #include "Buffer.h"
+#include "Bounds.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "Utils.h"
 
 #include <memory>
 #include <vector>
@@ -18,10 +23,16 @@ private:
 	std::unique_ptr<Buffer> m_vertexBuffer;
 	uint32_t m_vertexCount;
 
+	// Only the positions, tightly packed, so passes that need nothing else (like a depth pre-pass) fetch 12 bytes
+	// per vertex instead of a whole Vertex
+	std::unique_ptr<Buffer> m_positionBuffer;
+
 	bool m_hasIndexBuffer = false;
 	std::unique_ptr<Buffer> m_indexBuffer;
 	uint32_t m_indexCount;
 
+	AABB m_bounds;
+
 public:
 	struct Vertex
 	{
@@ -33,6 +44,10 @@ public:
 		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 
+		// For pipelines that read the position stream bound by bindPositions
+		static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
+
 		bool operator==(const Vertex& other) const
 		{
 			return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
@@ -45,6 +60,8 @@ public:
 		std::vector<uint32_t> indices{};
 
 		void loadModel(const std::string& filePath);
+		// Indexed sphere with a radius of 0.5 around the origin, the detail grows with the amount of segments and rings
+		void generateSphere(uint32_t segments, uint32_t rings);
 	};
 
 	Model(Device& device, const Data& data);
@@ -56,9 +73,39 @@ public:
 	static std::unique_ptr<Model> CreateModelFromFile(Device& device, const std::string& filePath);
 
 	void bind(VkCommandBuffer commandBuffer);
+	// Binds the position stream instead of the full vertices, the draw functions work the same for both
+	void bindPositions(VkCommandBuffer commandBuffer);
 	void draw(VkCommandBuffer commandBuffer);
 
+	// drawCount commands from the buffer, VkDrawIndexedIndirectCommand when the model has an index buffer and
+	// VkDrawIndirectCommand otherwise
+	void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+
+	bool hasIndexBuffer() const { return m_hasIndexBuffer; }
+
+	// Index count for indexed models, vertex count otherwise
+	uint32_t getDrawCount() const { return m_hasIndexBuffer ? m_indexCount : m_vertexCount; }
+
+	// Bounds of the vertices in model space
+	const AABB& getBounds() const { return m_bounds; }
+
 private:
 	void createVertexBuffer(const std::vector<Vertex>& vertices);
+	void createPositionBuffer(const std::vector<Vertex>& vertices);
 	void createIndexBuffer(const std::vector<uint32_t>& indices);
-};
\ No newline at end of file
+};
+
+// Lets vertices be deduplicated with a hash map when loading
+namespace std
+{
+	template<>
+	struct hash<Model::Vertex>
+	{
+		size_t operator()(Model::Vertex const& vertex) const
+		{
+			size_t seed = 0;
+			HashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+}
\ No newline at end of file
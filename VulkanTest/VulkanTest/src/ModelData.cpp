@@ -0,0 +1,121 @@
+#include "Model.h"
+#include "CpuProfiler.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "../libs/TinyObjLoader.h"
+#include <glm/gtc/constants.hpp>
+
+void Model::Data::loadModel(const std::string& filePath)
+{
+	PROFILE_ZONE("Model::Data::loadModel");
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, error;
+
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &error, filePath.c_str()))
+	{
+		throw std::runtime_error(warn + error);
+	}
+
+	vertices.clear();
+	indices.clear();
+
+	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+	for (const auto& shape : shapes)
+	{
+		for (const auto& index : shape.mesh.indices)
+		{
+			Vertex vertex{};
+
+			if (index.vertex_index >= 0)
+			{
+				vertex.position =
+				{
+					attrib.vertices[3 * index.vertex_index + 0],
+					attrib.vertices[3 * index.vertex_index + 1],
+					attrib.vertices[3 * index.vertex_index + 2],
+				};
+
+				vertex.color =
+				{
+					attrib.colors[3 * index.vertex_index + 0],
+					attrib.colors[3 * index.vertex_index + 1],
+					attrib.colors[3 * index.vertex_index + 2],
+				};
+			}
+
+			if (index.normal_index >= 0)
+			{
+				vertex.normal =
+				{
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2],
+				};
+			}
+
+			if (index.texcoord_index >= 0)
+			{
+				vertex.uv =
+				{
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					attrib.texcoords[2 * index.texcoord_index + 1],
+				};
+			}
+
+			if (uniqueVertices.count(vertex) == 0)
+			{
+				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+
+			indices.push_back(uniqueVertices[vertex]);
+		}
+	}
+}
+
+void Model::Data::generateSphere(uint32_t segments, uint32_t rings)
+{
+	vertices.clear();
+	indices.clear();
+
+	// The first and last ring collapse into the poles, the seam column is duplicated so the uvs can wrap
+	for (uint32_t ring = 0; ring <= rings; ring++)
+	{
+		float v = static_cast<float>(ring) / rings;
+		float polar = v * glm::pi<float>();
+
+		for (uint32_t segment = 0; segment <= segments; segment++)
+		{
+			float u = static_cast<float>(segment) / segments;
+			float azimuth = u * glm::two_pi<float>();
+
+			Vertex vertex{};
+			vertex.normal = { std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth) };
+			vertex.position = vertex.normal * 0.5f;
+			vertex.color = vertex.normal * 0.5f + 0.5f;
+			vertex.uv = { u, v };
+			vertices.push_back(vertex);
+		}
+	}
+
+	uint32_t rowLength = segments + 1;
+	for (uint32_t ring = 0; ring < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t topLeft = ring * rowLength + segment;
+			uint32_t bottomLeft = topLeft + rowLength;
+
+			indices.insert(indices.end(), { topLeft, bottomLeft, topLeft + 1 });
+			indices.insert(indices.end(), { topLeft + 1, bottomLeft, bottomLeft + 1 });
+		}
+	}
+}
\ No newline at end of file
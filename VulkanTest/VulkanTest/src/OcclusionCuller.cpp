@@ -0,0 +1,383 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// Triangles with a vertex closer than this (in clip space w) are not clipped but skipped, which only makes the
+// culling a bit more conservative
+static constexpr float MIN_CLIP_W = 1e-4f;
+
+OcclusionMesh OcclusionMesh::CreateBox(const AABB& bounds)
+{
+	OcclusionMesh mesh{};
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		mesh.positions.push_back(glm::vec3
+		(
+			(corner & 1) ? bounds.max.x : bounds.min.x,
+			(corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z
+		));
+	}
+
+	// Two triangles per face, the winding doesn't matter because occluders are rasterized from both sides
+	mesh.indices =
+	{
+		0, 2, 1, 1, 2, 3,	// -z
+		4, 5, 6, 5, 7, 6,	// +z
+		0, 1, 4, 1, 5, 4,	// -y
+		2, 6, 3, 3, 6, 7,	// +y
+		0, 4, 2, 2, 4, 6,	// -x
+		1, 3, 5, 3, 7, 5	// +x
+	};
+
+	return mesh;
+}
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+	: m_width(width), m_height(height), m_tileCountX(width / TILE_WIDTH), m_tileCountY(height / TILE_HEIGHT)
+{
+	assert(width % TILE_WIDTH == 0 && height % TILE_HEIGHT == 0 && "Occlusion buffer size has to be a multiple of the tile size");
+
+	m_depth.resize(static_cast<size_t>(m_width) * m_height, 1.0f);
+	m_tileMaxDepth.resize(static_cast<size_t>(m_tileCountX) * m_tileCountY, 1.0f);
+	m_tileBins.resize(m_tileMaxDepth.size());
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	std::fill(m_tileMaxDepth.begin(), m_tileMaxDepth.end(), 1.0f);
+
+	m_triangles.clear();
+	for (auto& bin : m_tileBins)
+	{
+		bin.clear();
+	}
+
+	m_stats = Stats{};
+}
+
+void OcclusionCuller::addOccluder(const OcclusionMesh& mesh, const glm::mat4& modelMatrix)
+{
+	glm::mat4 modelViewProjection = m_viewProjection * modelMatrix;
+
+	m_clipPositions.resize(mesh.positions.size());
+	for (size_t i = 0; i < mesh.positions.size(); i++)
+	{
+		m_clipPositions[i] = modelViewProjection * glm::vec4(mesh.positions[i], 1.0f);
+	}
+
+	size_t indexCount = mesh.indices.empty() ? mesh.positions.size() : mesh.indices.size();
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		Triangle triangle{};
+		bool valid = true;
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			size_t index = mesh.indices.empty() ? i + corner : mesh.indices[i + corner];
+			const glm::vec4& clip = m_clipPositions[index];
+
+			if (clip.w < MIN_CLIP_W || clip.z < 0.0f)
+			{
+				valid = false;
+				break;
+			}
+
+			triangle.vertices[corner] = glm::vec3
+			(
+				(clip.x / clip.w * 0.5f + 0.5f) * m_width,
+				(clip.y / clip.w * 0.5f + 0.5f) * m_height,
+				clip.z / clip.w
+			);
+		}
+
+		if (!valid)
+		{
+			continue;
+		}
+
+		glm::vec3 min = glm::min(glm::min(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2]);
+		glm::vec3 max = glm::max(glm::max(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2]);
+
+		int minX = std::max(static_cast<int>(std::floor(min.x)), 0);
+		int minY = std::max(static_cast<int>(std::floor(min.y)), 0);
+		int maxX = std::min(static_cast<int>(std::ceil(max.x)), static_cast<int>(m_width));
+		int maxY = std::min(static_cast<int>(std::ceil(max.y)), static_cast<int>(m_height));
+
+		if (minX >= maxX || minY >= maxY || min.z >= 1.0f)
+		{
+			continue;
+		}
+
+		uint32_t triangleIndex = static_cast<uint32_t>(m_triangles.size());
+		m_triangles.push_back(triangle);
+
+		for (int tileY = minY / TILE_HEIGHT; tileY <= (maxY - 1) / static_cast<int>(TILE_HEIGHT); tileY++)
+		{
+			for (int tileX = minX / TILE_WIDTH; tileX <= (maxX - 1) / static_cast<int>(TILE_WIDTH); tileX++)
+			{
+				m_tileBins[tileY * m_tileCountX + tileX].push_back(triangleIndex);
+			}
+		}
+	}
+
+	m_stats.occluderCount++;
+}
+
+void OcclusionCuller::rasterize(ThreadPool* threadPool)
+{
+	PROFILE_ZONE("OcclusionCuller::rasterize");
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	uint32_t tileCount = m_tileCountX * m_tileCountY;
+
+	if (threadPool == nullptr || m_triangles.empty())
+	{
+		for (uint32_t tile = 0; tile < tileCount; tile++)
+		{
+			rasterizeTile(tile);
+		}
+	}
+	else
+	{
+		// Tiles don't share any pixels, so every task can write its tiles without synchronisation. Interleaved,
+		// because occluders tend to bunch up in the same part of the screen
+		uint32_t taskCount = std::min(threadPool->getThreadCount(), tileCount);
+		threadPool->parallelFor(taskCount, [&](uint32_t taskIndex, uint32_t)
+		{
+			for (uint32_t tile = taskIndex; tile < tileCount; tile += taskCount)
+			{
+				rasterizeTile(tile);
+			}
+		});
+	}
+
+	m_stats.triangleCount = static_cast<uint32_t>(m_triangles.size());
+	m_stats.rasterizeTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool OcclusionCuller::isOccluded(const AABB& bounds)
+{
+	m_stats.testedCount++;
+
+	glm::vec3 screenMin{ std::numeric_limits<float>::max() };
+	glm::vec3 screenMax{ -std::numeric_limits<float>::max() };
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 position
+		{
+			(corner & 1) ? bounds.max.x : bounds.min.x,
+			(corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z
+		};
+
+		glm::vec4 clip = m_viewProjection * glm::vec4(position, 1.0f);
+		if (clip.w < MIN_CLIP_W || clip.z < 0.0f)
+		{
+			return false;
+		}
+
+		glm::vec3 screen
+		{
+			(clip.x / clip.w * 0.5f + 0.5f) * m_width,
+			(clip.y / clip.w * 0.5f + 0.5f) * m_height,
+			clip.z / clip.w
+		};
+
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+	}
+
+	// Every pixel the rectangle touches counts, not only the ones whose center it covers
+	int minX = std::max(static_cast<int>(std::floor(screenMin.x)), 0);
+	int minY = std::max(static_cast<int>(std::floor(screenMin.y)), 0);
+	int maxX = std::min(static_cast<int>(std::ceil(screenMax.x)), static_cast<int>(m_width));
+	int maxY = std::min(static_cast<int>(std::ceil(screenMax.y)), static_cast<int>(m_height));
+
+	if (minX >= maxX || minY >= maxY)
+	{
+		return false;
+	}
+
+	float closestDepth = screenMin.z;
+
+	for (int tileY = minY / TILE_HEIGHT; tileY <= (maxY - 1) / static_cast<int>(TILE_HEIGHT); tileY++)
+	{
+		for (int tileX = minX / TILE_WIDTH; tileX <= (maxX - 1) / static_cast<int>(TILE_WIDTH); tileX++)
+		{
+			// Everything in this tile is in front of the object
+			if (closestDepth > m_tileMaxDepth[tileY * m_tileCountX + tileX])
+			{
+				continue;
+			}
+
+			int startX = std::max(minX, tileX * static_cast<int>(TILE_WIDTH));
+			int endX = std::min(maxX, (tileX + 1) * static_cast<int>(TILE_WIDTH));
+			int startY = std::max(minY, tileY * static_cast<int>(TILE_HEIGHT));
+			int endY = std::min(maxY, (tileY + 1) * static_cast<int>(TILE_HEIGHT));
+
+			for (int y = startY; y < endY; y++)
+			{
+				const float* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+				for (int x = startX; x < endX; x++)
+				{
+					if (closestDepth <= row[x])
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	m_stats.occludedCount++;
+	return true;
+}
+
+void OcclusionCuller::rasterizeTile(uint32_t tile)
+{
+	uint32_t tileX = tile % m_tileCountX;
+	uint32_t tileY = tile / m_tileCountX;
+
+	uint32_t tileMinX = tileX * TILE_WIDTH;
+	uint32_t tileMinY = tileY * TILE_HEIGHT;
+	uint32_t tileMaxX = tileMinX + TILE_WIDTH;
+	uint32_t tileMaxY = tileMinY + TILE_HEIGHT;
+
+	for (uint32_t triangleIndex : m_tileBins[tile])
+	{
+		const Triangle& triangle = m_triangles[triangleIndex];
+
+		glm::vec3 min = glm::min(glm::min(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2]);
+		glm::vec3 max = glm::max(glm::max(triangle.vertices[0], triangle.vertices[1]), triangle.vertices[2]);
+
+		uint32_t minX = std::max(static_cast<uint32_t>(std::max(std::floor(min.x), 0.0f)), tileMinX);
+		uint32_t minY = std::max(static_cast<uint32_t>(std::max(std::floor(min.y), 0.0f)), tileMinY);
+		uint32_t maxX = std::min(static_cast<uint32_t>(std::max(std::ceil(max.x), 0.0f)), tileMaxX);
+		uint32_t maxY = std::min(static_cast<uint32_t>(std::max(std::ceil(max.y), 0.0f)), tileMaxY);
+
+		if (minX < maxX && minY < maxY)
+		{
+			rasterizeTriangle(triangle, minX, minY, maxX, maxY);
+		}
+	}
+
+	float maxDepth = 0.0f;
+	for (uint32_t y = tileMinY; y < tileMaxY; y++)
+	{
+		const float* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		for (uint32_t x = tileMinX; x < tileMaxX; x++)
+		{
+			maxDepth = std::max(maxDepth, row[x]);
+		}
+	}
+
+	m_tileMaxDepth[tile] = maxDepth;
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle& triangle, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY)
+{
+	glm::vec3 v0 = triangle.vertices[0];
+	glm::vec3 v1 = triangle.vertices[1];
+	glm::vec3 v2 = triangle.vertices[2];
+
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (std::abs(area) < 1e-8f)
+	{
+		return;
+	}
+
+	// Occluders are rasterized from both sides, so the winding is made consistent instead of culling back faces
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	// Edge functions E(x, y) = a * x + b * y + c, positive on the inside. The edge opposite of a vertex divided by
+	// the area is the barycentric weight of that vertex, which gives the depth plane
+	auto edge = [](const glm::vec3& from, const glm::vec3& to)
+	{
+		float a = from.y - to.y;
+		float b = to.x - from.x;
+		return glm::vec3(a, b, -(a * from.x + b * from.y));
+	};
+
+	glm::vec3 edge12 = edge(v1, v2);
+	glm::vec3 edge20 = edge(v2, v0);
+	glm::vec3 edge01 = edge(v0, v1);
+	glm::vec3 depthPlane = (edge12 * v0.z + edge20 * v1.z + edge01 * v2.z) / area;
+
+	// Rows are processed 4 pixels at a time from a 4 pixel aligned start, the tiles are aligned so this never
+	// leaves the tile. Pixels outside of the bounding box are rejected by the edge functions
+	uint32_t startX = minX & ~3u;
+
+#if SIMD_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (uint32_t y = minY; y < maxY; y++)
+	{
+		float* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		float pixelY = y + 0.5f;
+
+		const __m128 rowEdge12 = _mm_set1_ps(edge12.y * pixelY + edge12.z);
+		const __m128 rowEdge20 = _mm_set1_ps(edge20.y * pixelY + edge20.z);
+		const __m128 rowEdge01 = _mm_set1_ps(edge01.y * pixelY + edge01.z);
+		const __m128 rowDepth = _mm_set1_ps(depthPlane.y * pixelY + depthPlane.z);
+
+		for (uint32_t x = startX; x < maxX; x += 4)
+		{
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+
+			__m128 e12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge12.x), pixelX), rowEdge12);
+			__m128 e20 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge20.x), pixelX), rowEdge20);
+			__m128 e01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge01.x), pixelX), rowEdge01);
+
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e12, zero), _mm_cmpge_ps(e20, zero)), _mm_cmpge_ps(e01, zero));
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthPlane.x), pixelX), rowDepth);
+			__m128 current = _mm_loadu_ps(row + x);
+			__m128 closest = _mm_min_ps(current, depth);
+
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, current)));
+		}
+	}
+#else
+	for (uint32_t y = minY; y < maxY; y++)
+	{
+		float* row = m_depth.data() + static_cast<size_t>(y) * m_width;
+		float pixelY = y + 0.5f;
+
+		for (uint32_t x = startX; x < maxX; x++)
+		{
+			float pixelX = x + 0.5f;
+
+			if (edge12.x * pixelX + edge12.y * pixelY + edge12.z >= 0.0f &&
+				edge20.x * pixelX + edge20.y * pixelY + edge20.z >= 0.0f &&
+				edge01.x * pixelX + edge01.y * pixelY + edge01.z >= 0.0f)
+			{
+				float depth = depthPlane.x * pixelX + depthPlane.y * pixelY + depthPlane.z;
+				row[x] = std::min(row[x], depth);
+			}
+		}
+	}
+#endif
+}
\ No newline at end of file
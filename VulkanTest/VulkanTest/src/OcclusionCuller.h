@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Triangles of an occluder, usually a simplified version of the rendered mesh that stays inside of it
+struct OcclusionMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	// 12 triangles covering the box, the simplest occluder for solid objects
+	static OcclusionMesh CreateBox(const AABB& bounds);
+};
+
+// Low resolution software depth buffer for occlusion culling. Every frame the occluders get transformed and
+// binned into screen tiles, the tiles get rasterized in parallel (4 pixels at a time with SSE2) keeping the
+// closest depth, and then the bounds of objects can be tested against it. An object is occluded when its closest
+// depth is behind the occluder depth of every pixel its screen rectangle covers. Depth is the Vulkan depth
+// (0 near, 1 far)
+class OcclusionCuller
+{
+public:
+	static constexpr uint32_t DEFAULT_WIDTH = 320;
+	static constexpr uint32_t DEFAULT_HEIGHT = 192;
+	static constexpr uint32_t TILE_WIDTH = 64;
+	static constexpr uint32_t TILE_HEIGHT = 32;
+
+	struct Stats
+	{
+		uint32_t occluderCount = 0;
+		uint32_t triangleCount = 0;
+		uint32_t testedCount = 0;
+		uint32_t occludedCount = 0;
+		float rasterizeTimeMs = 0.0f;
+	};
+
+private:
+	// Screen space (pixels), z is the depth
+	struct Triangle
+	{
+		glm::vec3 vertices[3];
+	};
+
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_tileCountX;
+	uint32_t m_tileCountY;
+
+	glm::mat4 m_viewProjection{ 1.0f };
+
+	std::vector<float> m_depth;
+	std::vector<float> m_tileMaxDepth;
+
+	std::vector<Triangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_tileBins;
+	std::vector<glm::vec4> m_clipPositions;
+
+	Stats m_stats;
+
+public:
+	// The width has to be a multiple of TILE_WIDTH and the height a multiple of TILE_HEIGHT
+	OcclusionCuller(uint32_t width = DEFAULT_WIDTH, uint32_t height = DEFAULT_HEIGHT);
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	void beginFrame(const glm::mat4& viewProjection);
+	void addOccluder(const OcclusionMesh& mesh, const glm::mat4& modelMatrix);
+
+	// Rasterizes all added occluders, spreading the tiles over the thread pool when there is one
+	void rasterize(ThreadPool* threadPool);
+
+	// Conservative, anything that is not certainly hidden (like bounds crossing the near plane) is not occluded
+	bool isOccluded(const AABB& bounds);
+
+	const Stats& getStats() const { return m_stats; }
+
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	const std::vector<float>& getDepth() const { return m_depth; }
+
+private:
+	void rasterizeTile(uint32_t tile);
+	void rasterizeTriangle(const Triangle& triangle, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY);
+};
\ No newline at end of file
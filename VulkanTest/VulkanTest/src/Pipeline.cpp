@@ -11,30 +11,57 @@ Pipeline::Pipeline(Device& device, const std::string& vertexFilePath, const std:
 	assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
 	assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
 
-	std::vector<char> vertCode = ReadFile(vertexFilePath);
-	std::vector<char> fragCode = ReadFile(fragmentFilePath);
+	m_vertShaderModule = CreateShaderModule(m_device, ReadFile(vertexFilePath));
+	if (!fragmentFilePath.empty())
+	{
+		m_fragShaderModule = CreateShaderModule(m_device, ReadFile(fragmentFilePath));
+	}
+
+	createGraphicsPipeline(m_vertShaderModule, m_fragShaderModule, configInfo);
+}
+
+Pipeline::Pipeline(Device& device, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo)
+	: m_device(device)
+{
+	assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
+	assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
+
+	createGraphicsPipeline(vertShaderModule, fragShaderModule, configInfo);
+}
 
-	createShaderModule(vertCode, &m_vertShaderModule);
-	createShaderModule(fragCode, &m_fragShaderModule);
+void Pipeline::createGraphicsPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo)
+{
+	uint32_t stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
+
+	// Stages without constants keep the defaults from the shader
+	VkSpecializationInfo specializationInfos[2]{};
+	const SpecializationConstants* specializations[2] = { &configInfo.vertexSpecialization, &configInfo.fragmentSpecialization };
+	for (int i = 0; i < 2; i++)
+	{
+		specializationInfos[i].mapEntryCount = static_cast<uint32_t>(specializations[i]->mapEntries.size());
+		specializationInfos[i].pMapEntries = specializations[i]->mapEntries.data();
+		specializationInfos[i].dataSize = specializations[i]->data.size();
+		specializationInfos[i].pData = specializations[i]->data.data();
+	}
 
 	VkPipelineShaderStageCreateInfo shaderStages[2];
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shaderStages[0].module = m_vertShaderModule;
+	shaderStages[0].module = vertShaderModule;
 	shaderStages[0].pName = "main";
 	shaderStages[0].flags = 0;
 	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
+	shaderStages[0].pSpecializationInfo = configInfo.vertexSpecialization.empty() ? nullptr : &specializationInfos[0];
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shaderStages[1].module = m_fragShaderModule;
+	shaderStages[1].module = fragShaderModule;
 	shaderStages[1].pName = "main";
 	shaderStages[1].flags = 0;
 	shaderStages[1].pNext = nullptr;
-	shaderStages[1].pSpecializationInfo = nullptr;
+	shaderStages[1].pSpecializationInfo = configInfo.fragmentSpecialization.empty() ? nullptr : &specializationInfos[1];
 
-	auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
-	auto bindingDescriptions = Model::Vertex::getBindingDescriptions();
+	auto& attributeDescriptions = configInfo.attributeDescriptions;
+	auto& bindingDescriptions = configInfo.bindingDescriptions;
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -44,7 +71,7 @@ Pipeline::Pipeline(Device& device, const std::string& vertexFilePath, const std:
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	pipelineInfo.stageCount = stageCount;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -71,9 +98,13 @@ Pipeline::Pipeline(Device& device, const std::string& vertexFilePath, const std:
 
 Pipeline::~Pipeline()
 {
+	// Null when the modules are owned by someone else
 	vkDestroyShaderModule(m_device.device(), m_vertShaderModule, nullptr);
 	vkDestroyShaderModule(m_device.device(), m_fragShaderModule, nullptr);
-	vkDestroyPipeline(m_device.device(), m_graphicsPipeline, nullptr);
+
+	// The shader modules are only needed to create the pipeline, the pipeline itself might still be in use
+	VkPipeline pipeline = m_graphicsPipeline;
+	m_device.destroyDeferred([pipeline](VkDevice device) { vkDestroyPipeline(device, pipeline, nullptr); });
 }
 
 void Pipeline::bind(VkCommandBuffer commandBuffer)
@@ -150,20 +181,26 @@ void Pipeline::DefaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 	configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
 	configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 	configInfo.dynamicStateInfo.flags = 0;
+
+	configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
+	configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
 }
 
-void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
+VkShaderModule Pipeline::CreateShaderModule(Device& device, const std::vector<char>& code)
 {
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	createInfo.codeSize = code.size();
 	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-	bool result = vkCreateShaderModule(m_device.device(), &createInfo, nullptr, shaderModule);
+	VkShaderModule shaderModule;
+	VkResult result = vkCreateShaderModule(device.device(), &createInfo, nullptr, &shaderModule);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create shader module");
 	}
+
+	return shaderModule;
 }
 
 std::vector<char> Pipeline::ReadFile(const std::string& filePath)
@@ -184,3 +221,52 @@ std::vector<char> Pipeline::ReadFile(const std::string& filePath)
 	file.close();
 	return buffer;
 }
+
+
+ComputePipeline::ComputePipeline(Device& device, const std::string& computeFilePath, VkPipelineLayout pipelineLayout)
+	: m_device(device)
+{
+	assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline:: no pipelineLayout provided");
+
+	std::vector<char> code = Pipeline::ReadFile(computeFilePath);
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkResult result = vkCreateShaderModule(m_device.device(), &moduleInfo, nullptr, &m_shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = m_shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	result = vkCreateComputePipelines(m_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_computePipeline);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create compute pipeline");
+	}
+}
+
+ComputePipeline::~ComputePipeline()
+{
+	vkDestroyShaderModule(m_device.device(), m_shaderModule, nullptr);
+
+	VkPipeline pipeline = m_computePipeline;
+	m_device.destroyDeferred([pipeline](VkDevice device) { vkDestroyPipeline(device, pipeline, nullptr); });
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
+}
\ No newline at end of file
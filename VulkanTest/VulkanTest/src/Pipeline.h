@@ -1,10 +1,44 @@
 #pragma once
 
+#include <cassert>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "Device.h"
 
+// Values for the specialization constants (layout(constant_id = ...)) of one shader stage. The driver compiles them in
+// as real constants, so one shader module can give variants without paying for the branches between them
+struct SpecializationConstants
+{
+	std::vector<VkSpecializationMapEntry> mapEntries;
+	std::vector<uint8_t> data;
+
+	// Setting a constant again overwrites it. Booleans are 32 bit in SPIR-V, so they have to be set as VkBool32
+	template<typename T>
+	void set(uint32_t constantId, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool>, "Specialization constants are scalars, use VkBool32 for booleans");
+
+		for (const auto& entry : mapEntries)
+		{
+			if (entry.constantID == constantId)
+			{
+				assert(entry.size == sizeof(T) && "Specialization constant set again with a different size");
+				std::memcpy(data.data() + entry.offset, &value, sizeof(T));
+				return;
+			}
+		}
+
+		mapEntries.push_back(VkSpecializationMapEntry{ constantId, static_cast<uint32_t>(data.size()), sizeof(T) });
+		data.resize(data.size() + sizeof(T));
+		std::memcpy(data.data() + mapEntries.back().offset, &value, sizeof(T));
+	}
+
+	bool empty() const { return mapEntries.empty(); }
+};
+
 struct PipelineConfigInfo
 {
 	PipelineConfigInfo() = default;
@@ -20,9 +54,13 @@ struct PipelineConfigInfo
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
 	std::vector<VkDynamicState> dynamicStateEnables;
 	VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
+	SpecializationConstants vertexSpecialization;
+	SpecializationConstants fragmentSpecialization;
 };
 
 class Pipeline
@@ -35,7 +73,12 @@ private:
 
 public:
 	Pipeline() = default;
+
+	// Without a fragment shader (an empty path) only the depth is written, for example for a depth pre-pass
 	Pipeline(Device& device, const std::string& vertexFilePath, const std::string& fragmentFilePath, const PipelineConfigInfo& configInfo);
+	// With shader modules owned by someone else (like the PipelineCache), they only have to live during the constructor.
+	// Without a fragment shader module (VK_NULL_HANDLE) only the depth is written
+	Pipeline(Device& device, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo);
 	~Pipeline();
 
 	Pipeline(const Pipeline&) = delete;
@@ -45,8 +88,26 @@ public:
 
 	static void DefaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
+	static std::vector<char> ReadFile(const std::string& filePath);
+	static VkShaderModule CreateShaderModule(Device& device, const std::vector<char>& code);
+
 private:
-	void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+	void createGraphicsPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo);
+};
 
-	static std::vector<char> ReadFile(const std::string& filePath);
+class ComputePipeline
+{
+private:
+	Device& m_device;
+	VkPipeline m_computePipeline{};
+	VkShaderModule m_shaderModule{};
+
+public:
+	ComputePipeline(Device& device, const std::string& computeFilePath, VkPipelineLayout pipelineLayout);
+	~ComputePipeline();
+
+	ComputePipeline(const ComputePipeline&) = delete;
+	ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+	void bind(VkCommandBuffer commandBuffer);
 };
\ No newline at end of file
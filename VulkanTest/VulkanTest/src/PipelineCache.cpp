@@ -0,0 +1,353 @@
+#include "PipelineCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+	// Every value is appended on its own, so padding in the Vulkan structs never ends up in the key
+	class KeyWriter
+	{
+	private:
+		std::string m_key;
+
+	public:
+		template<typename T>
+		KeyWriter& write(const T& value)
+		{
+			static_assert(std::is_scalar_v<T>, "Only write the fields of a struct, its padding is undefined");
+			m_key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			return *this;
+		}
+
+		KeyWriter& writeBytes(const void* data, size_t size)
+		{
+			write(size);
+			m_key.append(static_cast<const char*>(data), size);
+			return *this;
+		}
+
+		std::string take() { return std::move(m_key); }
+	};
+
+	void WriteSpecialization(KeyWriter& writer, const SpecializationConstants& specialization)
+	{
+		writer.write(specialization.mapEntries.size());
+		for (const auto& entry : specialization.mapEntries)
+		{
+			writer.write(entry.constantID).write(entry.offset).write(entry.size);
+		}
+		writer.writeBytes(specialization.data.data(), specialization.data.size());
+	}
+
+	// The config can't be copied because of the pointers into itself, which have to point into the copy instead
+	void CopyConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination)
+	{
+		assert((source.colorBlendInfo.attachmentCount == 0 || source.colorBlendInfo.pAttachments == &source.colorBlendAttachment) &&
+			"Only configs that blend with their own colorBlendAttachment can be compiled in the background");
+
+		destination.viewportInfo = source.viewportInfo;
+		destination.inputAssemblyInfo = source.inputAssemblyInfo;
+		destination.rasterizationInfo = source.rasterizationInfo;
+		destination.multisampleInfo = source.multisampleInfo;
+		destination.colorBlendAttachment = source.colorBlendAttachment;
+		destination.colorBlendInfo = source.colorBlendInfo;
+		destination.depthStencilInfo = source.depthStencilInfo;
+		destination.dynamicStateEnables = source.dynamicStateEnables;
+		destination.dynamicStateInfo = source.dynamicStateInfo;
+		destination.bindingDescriptions = source.bindingDescriptions;
+		destination.attributeDescriptions = source.attributeDescriptions;
+		destination.pipelineLayout = source.pipelineLayout;
+		destination.renderPass = source.renderPass;
+		destination.subpass = source.subpass;
+		destination.vertexSpecialization = source.vertexSpecialization;
+		destination.fragmentSpecialization = source.fragmentSpecialization;
+
+		destination.colorBlendInfo.pAttachments = source.colorBlendInfo.attachmentCount > 0 ? &destination.colorBlendAttachment : nullptr;
+		destination.dynamicStateInfo.pDynamicStates = destination.dynamicStateEnables.data();
+	}
+
+	void WriteStencilOp(KeyWriter& writer, const VkStencilOpState& state)
+	{
+		writer.write(state.failOp).write(state.passOp).write(state.depthFailOp).write(state.compareOp)
+			.write(state.compareMask).write(state.writeMask).write(state.reference);
+	}
+}
+
+PipelineCache::PipelineCache(Device& device): m_device(device)
+{
+
+}
+
+PipelineCache::~PipelineCache()
+{
+	// A pipeline that is being compiled is finished first, the queued ones are dropped
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	if (m_compileThread.joinable())
+	{
+		m_compileThread.join();
+	}
+
+	m_pendingJobs.clear();
+	m_pipelines.clear();
+
+	// Only needed to create the pipelines, which are done with them
+	for (const auto& [filePath, shaderModule] : m_shaderModules)
+	{
+		vkDestroyShaderModule(m_device.device(), shaderModule, nullptr);
+	}
+}
+
+Pipeline& PipelineCache::getPipeline(const std::string& vertexFilePath, const std::string& fragmentFilePath, const PipelineConfigInfo& configInfo)
+{
+	VkShaderModule vertShaderModule = getShaderModule(vertexFilePath);
+	VkShaderModule fragShaderModule = fragmentFilePath.empty() ? VK_NULL_HANDLE : getShaderModule(fragmentFilePath);
+
+	std::string key = CreateKey(vertShaderModule, fragShaderModule, configInfo);
+	auto it = m_pipelines.find(key);
+	if (it != m_pipelines.end())
+	{
+		m_stats.hitCount++;
+		return *it->second.pipeline;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto pipeline = std::make_unique<Pipeline>(m_device, vertShaderModule, fragShaderModule, configInfo);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	m_stats.missCount++;
+	m_stats.createTimeMs += std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+
+	return *m_pipelines.emplace(std::move(key), CachedPipeline{ configInfo.renderPass, std::move(pipeline) }).first->second.pipeline;
+}
+
+Pipeline* PipelineCache::requestPipeline(const std::string& vertexFilePath, const std::string& fragmentFilePath, const PipelineConfigInfo& configInfo, Pipeline* fallback)
+{
+	VkShaderModule vertShaderModule = getShaderModule(vertexFilePath);
+	VkShaderModule fragShaderModule = fragmentFilePath.empty() ? VK_NULL_HANDLE : getShaderModule(fragmentFilePath);
+
+	std::string key = CreateKey(vertShaderModule, fragShaderModule, configInfo);
+	auto it = m_pipelines.find(key);
+	if (it != m_pipelines.end())
+	{
+		m_stats.hitCount++;
+		return it->second.pipeline.get();
+	}
+
+	auto pendingIt = m_pendingJobs.find(key);
+	if (pendingIt == m_pendingJobs.end())
+	{
+		auto job = std::make_unique<CompileJob>();
+		job->key = key;
+		job->vertShaderModule = vertShaderModule;
+		job->fragShaderModule = fragShaderModule;
+		CopyConfigInfo(configInfo, job->configInfo);
+
+		if (!m_compileThread.joinable())
+		{
+			m_compileThread = std::thread(&PipelineCache::compileLoop, this);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queuedJobs.push_back(job.get());
+		}
+		m_jobAvailable.notify_one();
+
+		m_stats.missCount++;
+		pendingIt = m_pendingJobs.emplace(std::move(key), std::move(job)).first;
+	}
+
+	pendingIt->second->fallbackCount++;
+	m_stats.fallbackCount++;
+	if (fallback == nullptr)
+	{
+		m_stats.skippedCount++;
+	}
+
+	return fallback;
+}
+
+void PipelineCache::update()
+{
+	std::vector<CompileJob*> finishedJobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		finishedJobs.swap(m_finishedJobs);
+	}
+
+	for (CompileJob* finishedJob : finishedJobs)
+	{
+		auto pendingIt = m_pendingJobs.find(finishedJob->key);
+		std::unique_ptr<CompileJob> job = std::move(pendingIt->second);
+		m_pendingJobs.erase(pendingIt);
+
+		if (job->exception)
+		{
+			std::rethrow_exception(job->exception);
+		}
+
+		m_stats.asyncCompileCount++;
+		m_stats.asyncCompileTimeMs += job->compileTimeMs;
+		std::cout << "Compiled pipeline variant in " << job->compileTimeMs << " ms, requested " << job->fallbackCount
+			<< " times while compiling" << std::endl;
+
+		// Could have been created with getPipeline in the meantime, in which case the compiled one is dropped
+		m_pipelines.emplace(job->key, CachedPipeline{ job->configInfo.renderPass, std::move(job->pipeline) });
+	}
+}
+
+void PipelineCache::dropRenderPass(VkRenderPass renderPass)
+{
+	auto usesRenderPass = [renderPass](const CompileJob* job) { return job->configInfo.renderPass == renderPass; };
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_queuedJobs.erase(std::remove_if(m_queuedJobs.begin(), m_queuedJobs.end(), usesRenderPass), m_queuedJobs.end());
+
+		// A pipeline that is being compiled can't be stopped
+		m_jobFinished.wait(lock, [&]() { return m_compilingJob == nullptr || !usesRenderPass(m_compilingJob); });
+		m_finishedJobs.erase(std::remove_if(m_finishedJobs.begin(), m_finishedJobs.end(), usesRenderPass), m_finishedJobs.end());
+	}
+
+	// The compile thread has no pointers to these jobs anymore
+	for (auto it = m_pendingJobs.begin(); it != m_pendingJobs.end();)
+	{
+		it = usesRenderPass(it->second.get()) ? m_pendingJobs.erase(it) : std::next(it);
+	}
+
+	for (auto it = m_pipelines.begin(); it != m_pipelines.end();)
+	{
+		it = it->second.renderPass == renderPass ? m_pipelines.erase(it) : std::next(it);
+	}
+}
+
+void PipelineCache::compileLoop()
+{
+	while (true)
+	{
+		CompileJob* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_queuedJobs.empty(); });
+
+			if (m_stopping)
+			{
+				return;
+			}
+
+			job = m_queuedJobs.front();
+			m_queuedJobs.pop_front();
+			m_compilingJob = job;
+		}
+
+		try
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			job->pipeline = std::make_unique<Pipeline>(m_device, job->vertShaderModule, job->fragShaderModule, job->configInfo);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			job->compileTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+		}
+		catch (...)
+		{
+			job->exception = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finishedJobs.push_back(job);
+			m_compilingJob = nullptr;
+		}
+		m_jobFinished.notify_all();
+	}
+}
+
+VkShaderModule PipelineCache::getShaderModule(const std::string& filePath)
+{
+	auto it = m_shaderModules.find(filePath);
+	if (it != m_shaderModules.end())
+	{
+		return it->second;
+	}
+
+	VkShaderModule shaderModule = Pipeline::CreateShaderModule(m_device, Pipeline::ReadFile(filePath));
+	m_shaderModules.emplace(filePath, shaderModule);
+
+	return shaderModule;
+}
+
+std::string PipelineCache::CreateKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo)
+{
+	KeyWriter writer{};
+	writer.write(vertShaderModule).write(fragShaderModule).write(configInfo.renderPass).write(configInfo.subpass).write(configInfo.pipelineLayout);
+
+	const auto& inputAssembly = configInfo.inputAssemblyInfo;
+	writer.write(inputAssembly.topology).write(inputAssembly.primitiveRestartEnable);
+
+	// The viewports and scissors are dynamic, so only their counts matter
+	writer.write(configInfo.viewportInfo.viewportCount).write(configInfo.viewportInfo.scissorCount);
+
+	const auto& rasterization = configInfo.rasterizationInfo;
+	writer.write(rasterization.depthClampEnable).write(rasterization.rasterizerDiscardEnable).write(rasterization.polygonMode)
+		.write(rasterization.cullMode).write(rasterization.frontFace).write(rasterization.depthBiasEnable)
+		.write(rasterization.depthBiasConstantFactor).write(rasterization.depthBiasClamp).write(rasterization.depthBiasSlopeFactor)
+		.write(rasterization.lineWidth);
+
+	const auto& multisample = configInfo.multisampleInfo;
+	writer.write(multisample.rasterizationSamples).write(multisample.sampleShadingEnable).write(multisample.minSampleShading)
+		.write(multisample.alphaToCoverageEnable).write(multisample.alphaToOneEnable);
+
+	const auto& colorBlend = configInfo.colorBlendInfo;
+	writer.write(colorBlend.logicOpEnable).write(colorBlend.logicOp).write(colorBlend.attachmentCount);
+	for (uint32_t i = 0; i < colorBlend.attachmentCount; i++)
+	{
+		const VkPipelineColorBlendAttachmentState& attachment = colorBlend.pAttachments[i];
+		writer.write(attachment.blendEnable).write(attachment.srcColorBlendFactor).write(attachment.dstColorBlendFactor)
+			.write(attachment.colorBlendOp).write(attachment.srcAlphaBlendFactor).write(attachment.dstAlphaBlendFactor)
+			.write(attachment.alphaBlendOp).write(attachment.colorWriteMask);
+	}
+	for (float blendConstant : colorBlend.blendConstants)
+	{
+		writer.write(blendConstant);
+	}
+
+	const auto& depthStencil = configInfo.depthStencilInfo;
+	writer.write(depthStencil.depthTestEnable).write(depthStencil.depthWriteEnable).write(depthStencil.depthCompareOp)
+		.write(depthStencil.depthBoundsTestEnable).write(depthStencil.minDepthBounds).write(depthStencil.maxDepthBounds)
+		.write(depthStencil.stencilTestEnable);
+	WriteStencilOp(writer, depthStencil.front);
+	WriteStencilOp(writer, depthStencil.back);
+
+	writer.write(configInfo.dynamicStateEnables.size());
+	for (VkDynamicState dynamicState : configInfo.dynamicStateEnables)
+	{
+		writer.write(dynamicState);
+	}
+
+	writer.write(configInfo.bindingDescriptions.size());
+	for (const auto& binding : configInfo.bindingDescriptions)
+	{
+		writer.write(binding.binding).write(binding.stride).write(binding.inputRate);
+	}
+
+	writer.write(configInfo.attributeDescriptions.size());
+	for (const auto& attribute : configInfo.attributeDescriptions)
+	{
+		writer.write(attribute.location).write(attribute.binding).write(attribute.format).write(attribute.offset);
+	}
+
+	WriteSpecialization(writer, configInfo.vertexSpecialization);
+	WriteSpecialization(writer, configInfo.fragmentSpecialization);
+
+	return writer.take();
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Pipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Shares pipelines between everyone that asks for the same one. A pipeline is looked up by the state that ends up in
+// it (the fixed function state of the PipelineConfigInfo, the shaders, render pass, subpass and layout), so asking
+// for a variant (like the same pipeline with blending or another cull mode) only creates a pipeline the first time.
+// The shader modules are loaded once per file and kept for as long as the cache lives. Pointers into the cache stay
+// valid until it is destroyed, or until the render pass of the pipeline is dropped.
+// Pipelines can also be requested without waiting for them, they are then compiled on a background thread while the
+// caller draws with a fallback (or skips the draws). Finished pipelines only become available at update, so a
+// pipeline never changes in the middle of a frame
+class PipelineCache
+{
+public:
+	struct Stats
+	{
+		uint32_t hitCount = 0;
+		uint32_t missCount = 0;
+		float createTimeMs = 0.0f;
+
+		// Requests that weren't compiled yet, and of those the ones without a fallback (so the draws were skipped)
+		uint32_t asyncCompileCount = 0;
+		float asyncCompileTimeMs = 0.0f;
+		uint32_t fallbackCount = 0;
+		uint32_t skippedCount = 0;
+	};
+
+private:
+	struct CompileJob
+	{
+		std::string key;
+		VkShaderModule vertShaderModule;
+		VkShaderModule fragShaderModule;
+		PipelineConfigInfo configInfo;
+
+		// Written by the compile thread before the job is moved to the finished jobs
+		std::unique_ptr<Pipeline> pipeline;
+		float compileTimeMs = 0.0f;
+		std::exception_ptr exception;
+
+		uint32_t fallbackCount = 0;
+	};
+
+	struct CachedPipeline
+	{
+		VkRenderPass renderPass;
+		std::unique_ptr<Pipeline> pipeline;
+	};
+
+	Device& m_device;
+
+	std::unordered_map<std::string, VkShaderModule> m_shaderModules;
+	// Keyed on the relevant state written out as bytes, which the map hashes
+	std::unordered_map<std::string, CachedPipeline> m_pipelines;
+
+	Stats m_stats;
+
+	// Requested but not available yet, only used by the thread that requests
+	std::unordered_map<std::string, std::unique_ptr<CompileJob>> m_pendingJobs;
+
+	// Started with the first asynchronous request
+	std::thread m_compileThread;
+	std::mutex m_mutex;
+	std::condition_variable m_jobAvailable;
+	std::deque<CompileJob*> m_queuedJobs;
+	std::vector<CompileJob*> m_finishedJobs;
+	// The job the compile thread is working on, signalled once it is moved to the finished jobs
+	CompileJob* m_compilingJob = nullptr;
+	std::condition_variable m_jobFinished;
+	bool m_stopping = false;
+
+public:
+	PipelineCache(Device& device);
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Without a fragment shader (an empty path) only the depth is written, like the Pipeline constructor
+	Pipeline& getPipeline(const std::string& vertexFilePath, const std::string& fragmentFilePath, const PipelineConfigInfo& configInfo);
+
+	// Returns the pipeline when it's available. Otherwise it gets compiled on the background thread (requesting it again
+	// doesn't queue it again) and the fallback is returned, which can be null to skip the draws until it's done. The
+	// fallback has to work with the same render pass, layout and vertex input
+	Pipeline* requestPipeline(const std::string& vertexFilePath, const std::string& fragmentFilePath, const PipelineConfigInfo& configInfo, Pipeline* fallback = nullptr);
+
+	// Has to be called between frames, makes the pipelines that finished compiling available and logs their compile time
+	void update();
+
+	// Forgets every pipeline created for the render pass (destroyed once the frames using them are done) and drops
+	// the requests for it that weren't compiled yet. Has to be called between frames and before the render pass is
+	// destroyed, so it waits when the render pass is being compiled for on the background thread
+	void dropRenderPass(VkRenderPass renderPass);
+
+	VkShaderModule getShaderModule(const std::string& filePath);
+
+	const Stats& getStats() const { return m_stats; }
+	size_t getPipelineCount() const { return m_pipelines.size(); }
+
+	static std::string CreateKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo);
+
+private:
+	void compileLoop();
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "Registry.h"
+
+Entity Registry::create()
+{
+	Entity entity{};
+
+	if (!m_freeIndices.empty())
+	{
+		entity.index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = static_cast<uint32_t>(m_generations.size());
+		m_generations.push_back(0);
+	}
+
+	entity.generation = m_generations[entity.index];
+	m_aliveCount++;
+
+	return entity;
+}
+
+void Registry::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+	{
+		return;
+	}
+
+	for (auto& pool : m_pools)
+	{
+		if (pool != nullptr)
+		{
+			pool->remove(entity);
+		}
+	}
+
+	// Invalidates all handles that still point to this entity
+	m_generations[entity.index]++;
+	m_freeIndices.push_back(entity.index);
+	m_aliveCount--;
+}
+
+bool Registry::isAlive(Entity entity) const
+{
+	return entity.index < m_generations.size() && m_generations[entity.index] == entity.generation;
+}
+
+uint32_t Registry::NextComponentTypeId()
+{
+	static uint32_t nextTypeId = 0;
+	return nextTypeId++;
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Handle to an entity. The generation makes handles to a destroyed entity invalid, even after its index got reused
+struct Entity
+{
+	static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool isValid() const { return index != INVALID_INDEX; }
+
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+class ComponentPoolBase
+{
+public:
+	virtual ~ComponentPoolBase() = default;
+
+	// Does nothing when the entity doesn't have the component
+	virtual void remove(Entity entity) = 0;
+};
+
+// Sparse set: the components are tightly packed in one dense array (together with the entity they belong to),
+// the sparse array maps an entity index to the position of its component in the dense array
+template<typename T>
+class ComponentPool : public ComponentPoolBase
+{
+private:
+	static constexpr uint32_t NOT_PRESENT = std::numeric_limits<uint32_t>::max();
+
+	std::vector<uint32_t> m_sparse;
+	std::vector<Entity> m_entities;
+	std::vector<T> m_components;
+
+	uint32_t m_structureVersion = 0;
+
+public:
+	template<typename... Args>
+	T& add(Entity entity, Args&&... args)
+	{
+		assert(!has(entity) && "Entity already has this component");
+
+		if (entity.index >= m_sparse.size())
+		{
+			m_sparse.resize(entity.index + 1, NOT_PRESENT);
+		}
+
+		m_sparse[entity.index] = static_cast<uint32_t>(m_entities.size());
+		m_entities.push_back(entity);
+		m_components.push_back(T{ std::forward<Args>(args)... });
+		m_structureVersion++;
+
+		return m_components.back();
+	}
+
+	void remove(Entity entity) override
+	{
+		if (!has(entity))
+		{
+			return;
+		}
+
+		// Swap with the last component, so the dense arrays stay without holes
+		uint32_t denseIndex = m_sparse[entity.index];
+		uint32_t lastIndex = static_cast<uint32_t>(m_entities.size() - 1);
+		if (denseIndex != lastIndex)
+		{
+			m_entities[denseIndex] = m_entities[lastIndex];
+			m_components[denseIndex] = std::move(m_components[lastIndex]);
+			m_sparse[m_entities[denseIndex].index] = denseIndex;
+		}
+
+		m_entities.pop_back();
+		m_components.pop_back();
+		m_sparse[entity.index] = NOT_PRESENT;
+		m_structureVersion++;
+	}
+
+	bool has(Entity entity) const
+	{
+		return entity.index < m_sparse.size() && m_sparse[entity.index] != NOT_PRESENT && m_entities[m_sparse[entity.index]] == entity;
+	}
+
+	T& get(Entity entity)
+	{
+		assert(has(entity) && "Entity does not have this component");
+		return m_components[m_sparse[entity.index]];
+	}
+
+	const T& get(Entity entity) const
+	{
+		assert(has(entity) && "Entity does not have this component");
+		return m_components[m_sparse[entity.index]];
+	}
+
+	T* tryGet(Entity entity) { return has(entity) ? &m_components[m_sparse[entity.index]] : nullptr; }
+	const T* tryGet(Entity entity) const { return has(entity) ? &m_components[m_sparse[entity.index]] : nullptr; }
+
+	// Dense access, the order changes when components get removed
+	size_t size() const { return m_components.size(); }
+	Entity getEntity(size_t denseIndex) const { return m_entities[denseIndex]; }
+	T& operator[](size_t denseIndex) { return m_components[denseIndex]; }
+	const T& operator[](size_t denseIndex) const { return m_components[denseIndex]; }
+	T* data() { return m_components.data(); }
+
+	// Changes every time a component gets added or removed, so systems that mirror the pool know when to resync
+	uint32_t getStructureVersion() const { return m_structureVersion; }
+};
+
+// Owns all entities and their components. Every component type gets its own pool, so systems only touch the
+// arrays of the components they actually need
+class Registry
+{
+private:
+	std::vector<uint32_t> m_generations;
+	std::vector<uint32_t> m_freeIndices;
+	size_t m_aliveCount = 0;
+
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+
+public:
+	Registry() = default;
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	Entity create();
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+
+	size_t size() const { return m_aliveCount; }
+
+	template<typename T, typename... Args>
+	T& add(Entity entity, Args&&... args)
+	{
+		assert(isAlive(entity) && "Cannot add a component to a destroyed entity");
+		return getPool<T>().add(entity, std::forward<Args>(args)...);
+	}
+
+	template<typename T>
+	void remove(Entity entity) { getPool<T>().remove(entity); }
+
+	template<typename T>
+	bool has(Entity entity) { return getPool<T>().has(entity); }
+
+	template<typename T>
+	T& get(Entity entity) { return getPool<T>().get(entity); }
+
+	template<typename T>
+	T* tryGet(Entity entity) { return getPool<T>().tryGet(entity); }
+
+	template<typename T>
+	ComponentPool<T>& getPool()
+	{
+		uint32_t typeId = GetComponentTypeId<T>();
+		if (typeId >= m_pools.size())
+		{
+			m_pools.resize(typeId + 1);
+		}
+
+		if (m_pools[typeId] == nullptr)
+		{
+			m_pools[typeId] = std::make_unique<ComponentPool<T>>();
+		}
+
+		return static_cast<ComponentPool<T>&>(*m_pools[typeId]);
+	}
+
+	// Calls function(entity, T&, Others&...) for every entity that has all of the components, walking the dense
+	// array of T (so T should be the rarest of them). Components of these types may not be added or removed
+	// while iterating
+	template<typename T, typename... Others, typename Function>
+	void each(Function&& function)
+	{
+		ComponentPool<T>& pool = getPool<T>();
+		std::tuple<ComponentPool<Others>&...> others{ getPool<Others>()... };
+
+		for (size_t i = 0; i < pool.size(); i++)
+		{
+			Entity entity = pool.getEntity(i);
+
+			if ((std::get<ComponentPool<Others>&>(others).has(entity) && ...))
+			{
+				function(entity, pool[i], std::get<ComponentPool<Others>&>(others).get(entity)...);
+			}
+		}
+	}
+
+private:
+	static uint32_t NextComponentTypeId();
+
+	template<typename T>
+	static uint32_t GetComponentTypeId()
+	{
+		static const uint32_t typeId = NextComponentTypeId();
+		return typeId;
+	}
+};
\ No newline at end of file
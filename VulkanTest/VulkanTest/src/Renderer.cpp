@@ -1,16 +1,22 @@
 #include "Renderer.h"
+#include "CpuProfiler.h"
 #include <stdexcept>
 #include <array>
+#include <algorithm>
 
-Renderer::Renderer(Window& window, Device& device): m_window(window), m_device(device)
+Renderer::Renderer(Window& window, Device& device, int framesInFlight): m_window(window), m_device(device), m_framesInFlight(framesInFlight)
 {
+	m_frameBeginTimes.resize(m_framesInFlight);
+	m_framesPending.resize(m_framesInFlight, false);
+
 	recreateSwapChain();
-	createCommandBuffers();
+	createFrameCommandPools();
 }
 
 Renderer::~Renderer()
 {
-	freeCommandBuffers();
+	m_secondaryCommandPools.clear();
+	m_frameCommandPools.clear();
 }
 
 void Renderer::recreateSwapChain()
@@ -22,14 +28,14 @@ void Renderer::recreateSwapChain()
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(m_device.device());
-
 	if (m_swapChain == nullptr)
 	{
-		m_swapChain = std::make_unique<SwapChain>(m_device, extent);
+		m_swapChain = std::make_unique<SwapChain>(m_device, extent, m_framesInFlight);
 	}
 	else
 	{
+		// The new swap chain takes over right away (through oldSwapchain), the frames still in flight keep
+		// using the old one until they are done
 		std::shared_ptr<SwapChain> oldSwapChain = std::move(m_swapChain);
 		m_swapChain = std::make_unique<SwapChain>(m_device, extent, oldSwapChain);
 
@@ -37,36 +43,54 @@ void Renderer::recreateSwapChain()
 		{
 			throw std::runtime_error("Swap chain image format has changed");
 		}
+
+		// Destroyed once every frame submitted before the replacement is done, instead of stalling on every resize
+		m_device.destroyDeferred([oldSwapChain](VkDevice) mutable { oldSwapChain = nullptr; });
 	}
+
+	m_swapChainVersion++;
 }
 
-void Renderer::createCommandBuffers()
+void Renderer::createFrameCommandPools()
 {
-	m_commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_device.getCommandPool();
-	allocInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
-
-	bool result = vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_commandBuffers.data());
-	if (result != VK_SUCCESS)
+	// The command buffers are recorded once per frame, so the pools don't need to reset them individually
+	m_frameCommandPools.resize(m_framesInFlight);
+	for (auto& commandPool : m_frameCommandPools)
 	{
-		throw std::runtime_error("Failed to allocate command buffers");
+		commandPool = std::make_unique<CommandPool>(m_device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
 	}
 }
 
-void Renderer::freeCommandBuffers()
+void Renderer::resetFrameCommandPools()
 {
-	vkFreeCommandBuffers(m_device.device(), m_device.getCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-	m_commandBuffers.clear();
+	auto startTime = std::chrono::steady_clock::now();
+
+	m_frameCommandPools[m_currentFrameIndex]->reset();
+
+	// The secondary command buffers recorded the last time this frame index was used are done as well
+	if (isMultithreadedRecording())
+	{
+		for (auto& commandPool : m_secondaryCommandPools[m_currentFrameIndex])
+		{
+			commandPool->reset();
+		}
+	}
+
+	m_currentCommandBuffer = m_frameCommandPools[m_currentFrameIndex]->requestCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	m_commandPoolStats.totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	m_commandPoolStats.frameCount++;
 }
 
 VkCommandBuffer Renderer::beginFrame()
 {
+	PROFILE_ZONE("Renderer::beginFrame");
+
 	assert(!m_isFrameStarted && "Cannot begin frame, frame has already been started");
 
+	auto beginTime = std::chrono::steady_clock::now();
+	collectFinishedFrames();
+
 	auto result = m_swapChain->acquireNextImage(&m_currentImageIndex);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -82,9 +106,42 @@ VkCommandBuffer Renderer::beginFrame()
 
 	m_isFrameStarted = true;
 
+	// Acquiring waited for the last frame with this index, which is the earliest moment it is known to be done
+	collectFinishedFrames();
+	m_frameBeginTimes[m_currentFrameIndex] = beginTime;
+
+	uint64_t completedFrameCount = 0;
+	if (m_submittedFrameCount >= static_cast<uint64_t>(m_framesInFlight))
+	{
+		completedFrameCount = m_submittedFrameCount - m_framesInFlight + 1;
+	}
+
+	// With the timeline semaphore the frames after that are checked as well, so their resources are released as soon
+	// as the GPU is done with them instead of framesInFlight frames later
+	if (m_device.isTimelineSemaphoreEnabled())
+	{
+		uint64_t completedValue = m_device.getCompletedTimelineValue();
+		while (completedFrameCount < m_submittedFrameCount &&
+			m_swapChain->getFrameTimelineValue(completedFrameCount % m_framesInFlight) <= completedValue)
+		{
+			completedFrameCount++;
+		}
+	}
+
+	if (completedFrameCount > 0)
+	{
+		m_device.collectDeferredDestructions(completedFrameCount);
+	}
+
+	// This frame has been waited on while acquiring the image, so the command buffers recorded the last time this frame
+	// index was used are no longer in use
+	resetFrameCommandPools();
+	m_recordingStats.frameCount++;
+
 	auto commandBuffer = getCurrentCommandBuffer();
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 	result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
 	if (result != VK_SUCCESS)
@@ -97,16 +154,21 @@ VkCommandBuffer Renderer::beginFrame()
 
 void Renderer::endFrame()
 {
+	PROFILE_ZONE("Renderer::endFrame");
+
 	assert(m_isFrameStarted && "Cannot end frame if frame has not been started");
 
 	auto commandBuffer = getCurrentCommandBuffer();
-	bool result = vkEndCommandBuffer(commandBuffer);
+	VkResult result = vkEndCommandBuffer(commandBuffer);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to record command buffer");
 	}
 
 	result = m_swapChain->submitCommandBuffers(&commandBuffer, &m_currentImageIndex);
+	m_framesPending[m_currentFrameIndex] = true;
+	m_submittedFrameCount++;
+	m_device.setCurrentFrame(m_submittedFrameCount);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window.wasWindowResized())
 	{
@@ -119,18 +181,76 @@ void Renderer::endFrame()
 	}
 
 	m_isFrameStarted = false;
-	m_currentFrameIndex = (m_currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+	m_currentFrameIndex = (m_currentFrameIndex + 1) % m_framesInFlight;
 }
 
-void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::collectFinishedFrames()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < m_framesInFlight; i++)
+	{
+		if (!m_framesPending[i] || !m_swapChain->isFrameComplete(i))
+		{
+			continue;
+		}
+
+		double latencyMs = std::chrono::duration<double, std::milli>(now - m_frameBeginTimes[i]).count();
+		m_latencyStats.totalMs += latencyMs;
+		m_latencyStats.maxMs = std::max(m_latencyStats.maxMs, latencyMs);
+		m_latencyStats.frameCount++;
+
+		m_framesPending[i] = false;
+	}
+}
+
+Renderer::LatencyStats Renderer::takeLatencyStats()
+{
+	LatencyStats stats = m_latencyStats;
+	m_latencyStats = LatencyStats{};
+	return stats;
+}
+
+Renderer::CommandPoolStats Renderer::takeCommandPoolStats()
+{
+	CommandPoolStats stats = m_commandPoolStats;
+	m_commandPoolStats = CommandPoolStats{};
+	return stats;
+}
+
+Renderer::RecordingStats Renderer::takeRecordingStats()
+{
+	RecordingStats stats = m_recordingStats;
+	m_recordingStats = RecordingStats{};
+	return stats;
+}
+
+void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, RenderPassMode mode)
 {
 	assert(m_isFrameStarted && "Cannot call beginSwapChainRenderPass if frame has not been started");
 	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot begin render pass on command buffer from a different frame");
 
+	switch (mode)
+	{
+		case RenderPassMode::Clear:
+			m_currentRenderPass = m_swapChain->getRenderPass();
+			m_currentFramebuffer = m_swapChain->getFrameBuffer(m_currentImageIndex);
+			break;
+		case RenderPassMode::Load:
+			m_currentRenderPass = m_swapChain->getLoadRenderPass();
+			m_currentFramebuffer = m_swapChain->getFrameBuffer(m_currentImageIndex);
+			break;
+		case RenderPassMode::DepthPrepass:
+			m_currentRenderPass = m_swapChain->getDepthPrepassRenderPass();
+			m_currentFramebuffer = m_swapChain->getDepthPrepassFrameBuffer(m_currentImageIndex);
+			break;
+	}
+	m_currentSubpass = 0;
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_swapChain->getRenderPass();
-	renderPassInfo.framebuffer = m_swapChain->getFrameBuffer(m_currentImageIndex);
+	renderPassInfo.renderPass = m_currentRenderPass;
+	renderPassInfo.framebuffer = m_currentFramebuffer;
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = m_swapChain->getSwapChainExtent();
 
@@ -140,9 +260,92 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	// Start recording
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Start recording (a render pass is either recorded inline or only through secondary command buffers)
+	VkSubpassContents contents = isMultithreadedRecording() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+	// Dynamic state is not inherited by secondary command buffers, they set it themselves
+	if (!isMultithreadedRecording())
+	{
+		setViewportAndScissor(commandBuffer);
+	}
+}
+
+void Renderer::nextSwapChainSubpass(VkCommandBuffer commandBuffer)
+{
+	assert(m_isFrameStarted && "Cannot call nextSwapChainSubpass if frame has not been started");
+	assert(m_currentRenderPass != VK_NULL_HANDLE && "Cannot go to the next subpass outside of a render pass");
+
+	VkSubpassContents contents = isMultithreadedRecording() ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+	vkCmdNextSubpass(commandBuffer, contents);
+	m_currentSubpass++;
+}
 
+void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
+{
+	assert(m_isFrameStarted && "Cannot call endSwapChainRenderPass if frame has not been started");
+	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from a different frame");
+
+	vkCmdEndRenderPass(commandBuffer);
+	m_currentRenderPass = VK_NULL_HANDLE;
+	m_currentFramebuffer = VK_NULL_HANDLE;
+	m_currentSubpass = 0;
+}
+
+void Renderer::setRecordingThreadPool(ThreadPool* threadPool)
+{
+	assert(!m_isFrameStarted && "Cannot change the recording threads while a frame is in progress");
+
+	// The old pools are destroyed once the frames in flight that use them are done
+	m_recordingThreads = threadPool;
+	m_secondaryCommandPools.clear();
+
+	if (m_recordingThreads != nullptr)
+	{
+		createSecondaryCommandPools();
+	}
+}
+
+void Renderer::createSecondaryCommandPools()
+{
+	m_secondaryCommandPools.resize(m_framesInFlight);
+	for (auto& framePools : m_secondaryCommandPools)
+	{
+		for (uint32_t i = 0; i < m_recordingThreads->getThreadCount(); i++)
+		{
+			framePools.push_back(std::make_unique<CommandPool>(m_device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT));
+		}
+	}
+}
+
+VkCommandBuffer Renderer::beginSecondaryCommandBuffer(uint32_t threadIndex)
+{
+	VkCommandBuffer commandBuffer = m_secondaryCommandPools[m_currentFrameIndex][threadIndex]->requestCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_currentRenderPass;
+	inheritanceInfo.subpass = m_currentSubpass;
+	inheritanceInfo.framebuffer = m_currentFramebuffer;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to start recording secondary command buffer");
+	}
+
+	setViewportAndScissor(commandBuffer);
+
+	return commandBuffer;
+}
+
+void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -156,10 +359,53 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::recordCommands(VkCommandBuffer commandBuffer, uint32_t itemCount, const RecordFunction& record)
 {
-	assert(m_isFrameStarted && "Cannot call endSwapChainRenderPass if frame has not been started");
-	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from a different frame");
+	assert(m_isFrameStarted && "Cannot record commands if frame has not been started");
+	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot record commands on command buffer from a different frame");
 
-	vkCmdEndRenderPass(commandBuffer);
+	auto startTime = std::chrono::steady_clock::now();
+
+	if (!isMultithreadedRecording())
+	{
+		record(commandBuffer, 0, itemCount);
+	}
+	else if (itemCount > 0)
+	{
+		recordCommandsOnThreads(commandBuffer, itemCount, record);
+	}
+
+	m_recordingStats.totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	m_recordingStats.itemCount += itemCount;
+}
+
+void Renderer::recordCommandsOnThreads(VkCommandBuffer commandBuffer, uint32_t itemCount, const RecordFunction& record)
+{
+	uint32_t maxTaskCount = (itemCount + MIN_ITEMS_PER_RECORDING_TASK - 1) / MIN_ITEMS_PER_RECORDING_TASK;
+	uint32_t taskCount = std::min(m_recordingThreads->getThreadCount(), maxTaskCount);
+	uint32_t itemsPerTask = (itemCount + taskCount - 1) / taskCount;
+
+	// Every task writes its own slot, so the secondary command buffers are executed in item order
+	std::vector<VkCommandBuffer> secondaryCommandBuffers(taskCount);
+
+	m_recordingThreads->parallelFor(taskCount, [&](uint32_t taskIndex, uint32_t threadIndex)
+	{
+		PROFILE_ZONE("Renderer::recordCommands task");
+
+		uint32_t firstItem = taskIndex * itemsPerTask;
+		uint32_t taskItemCount = std::min(itemsPerTask, itemCount - firstItem);
+
+		VkCommandBuffer secondaryCommandBuffer = beginSecondaryCommandBuffer(threadIndex);
+		record(secondaryCommandBuffer, firstItem, taskItemCount);
+
+		VkResult result = vkEndCommandBuffer(secondaryCommandBuffer);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record secondary command buffer");
+		}
+
+		secondaryCommandBuffers[taskIndex] = secondaryCommandBuffer;
+	});
+
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
 }
\ No newline at end of file
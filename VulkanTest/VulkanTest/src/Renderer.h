@@ -3,40 +3,158 @@
 #include "Window.h"
 #include "Device.h"
 #include "SwapChain.h"
+#include "CommandPool.h"
+#include "ThreadPool.h"
 
 #include <memory>
 #include <vector>
 #include <cassert>
+#include <chrono>
+#include <functional>
 
 class Renderer
 {
+public:
+	// Time from beginFrame (right after the input of the frame was read) until the GPU finished the frame. The frames
+	// are checked at every beginFrame, so a frame counts as finished at the first beginFrame that sees it done
+	struct LatencyStats
+	{
+		double totalMs = 0.0;
+		double maxMs = 0.0;
+		uint32_t frameCount = 0;
+
+		double getAverageMs() const { return frameCount > 0 ? totalMs / frameCount : 0.0; }
+	};
+
+	// CPU time spent at the start of every frame on resetting the frame's command pools and getting its primary
+	// command buffer out of them
+	struct CommandPoolStats
+	{
+		double totalMs = 0.0;
+		uint32_t frameCount = 0;
+
+		double getAverageMs() const { return frameCount > 0 ? totalMs / frameCount : 0.0; }
+	};
+
+	// CPU time spent in recordCommands per frame, until the commands of every thread are recorded. Comparing it for
+	// different amounts of recording threads shows how well the recording scales
+	struct RecordingStats
+	{
+		double totalMs = 0.0;
+		uint64_t itemCount = 0;
+		uint32_t frameCount = 0;
+
+		double getAverageMs() const { return frameCount > 0 ? totalMs / frameCount : 0.0; }
+	};
+
 private:
 	Window& m_window;
 	Device& m_device;
 	std::unique_ptr<SwapChain> m_swapChain;
-	std::vector<VkCommandBuffer> m_commandBuffers;
+	int m_framesInFlight;
+
+	// One pool per frame in flight for the primary command buffer, reset as a whole once the frame is done instead of
+	// resetting command buffers one by one
+	std::vector<std::unique_ptr<CommandPool>> m_frameCommandPools;
+	VkCommandBuffer m_currentCommandBuffer = VK_NULL_HANDLE;
+
+	// Opt-in multithreaded recording: every worker records into secondary command buffers from its own pool,
+	// with one set of pools per frame in flight ([frameIndex][threadIndex])
+	ThreadPool* m_recordingThreads = nullptr;
+	std::vector<std::vector<std::unique_ptr<CommandPool>>> m_secondaryCommandPools;
 
 	uint32_t m_currentImageIndex;
 	int m_currentFrameIndex = 0;
 	bool m_isFrameStarted = false;
 
+	// The render pass (and subpass) that is currently being recorded, secondary command buffers have to inherit it
+	VkRenderPass m_currentRenderPass = VK_NULL_HANDLE;
+	VkFramebuffer m_currentFramebuffer = VK_NULL_HANDLE;
+	uint32_t m_currentSubpass = 0;
+
+	// When every frame in flight was begun and whether it is still waiting for the GPU, see LatencyStats
+	std::vector<std::chrono::steady_clock::time_point> m_frameBeginTimes;
+	std::vector<bool> m_framesPending;
+
+	// Bumped every time the swap chain gets recreated, so resources that depend on it can tell when to recreate
+	uint32_t m_swapChainVersion = 0;
+
+	// Amount of frames submitted so far, which is also the frame number of the device's deferred destructions.
+	// Beginning frame n waits for frame n - framesInFlight, so from then on every frame before it is done on the GPU
+	uint64_t m_submittedFrameCount = 0;
+
+	LatencyStats m_latencyStats;
+	CommandPoolStats m_commandPoolStats;
+	RecordingStats m_recordingStats;
+
 public:
-	Renderer(Window& m_window, Device& m_device);
+	enum class RenderPassMode
+	{
+		// Clears the color and depth
+		Clear,
+		// Keeps the color and depth rendered by an earlier swap chain render pass in this frame
+		Load,
+		// Clears like Clear, but starts in a depth only subpass. nextSwapChainSubpass moves on to the subpass that
+		// draws the color, which is compatible with getSwapChainDepthPrepassRenderPass subpass 1
+		DepthPrepass
+	};
+
+	// Called with the command buffer to record into and the range of items [firstItem, firstItem + itemCount) to record
+	using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t itemCount)>;
+
+	// Minimum amount of items a recording thread gets, so small scenes don't pay for secondary command buffers they don't need
+	static constexpr uint32_t MIN_ITEMS_PER_RECORDING_TASK = 256;
+
+	// framesInFlight is between SwapChain::MIN_FRAMES_IN_FLIGHT and SwapChain::MAX_FRAMES_IN_FLIGHT, every per frame
+	// resource of the systems that render with this renderer is sized from getFramesInFlight
+	Renderer(Window& m_window, Device& m_device, int framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT);
 	~Renderer();
 
 	Renderer(const Renderer&) = delete;
 	Renderer& operator=(const Renderer&) = delete;
 
 	VkRenderPass getSwapChainRenderPass() const { return m_swapChain->getRenderPass(); }
+	VkRenderPass getSwapChainDepthPrepassRenderPass() const { return m_swapChain->getDepthPrepassRenderPass(); }
 
 	float getAspectRatio() const { return m_swapChain->extentAspectRatio(); }
 
+	VkExtent2D getSwapChainExtent() const { return m_swapChain->getSwapChainExtent(); }
+	uint32_t getSwapChainImageCount() const { return static_cast<uint32_t>(m_swapChain->imageCount()); }
+	uint32_t getSwapChainVersion() const { return m_swapChainVersion; }
+
+	// Color image of every swap chain image, offscreen ones (see SwapChain::isOffscreen) can be copied from after a frame
+	VkImage getColorImage(uint32_t imageIndex) const { return m_swapChain->getImage(imageIndex); }
+	bool isOffscreen() const { return m_swapChain->isOffscreen(); }
+
+	// Depth attachment of every swap chain image, which is stored at the end of each render pass
+	VkImage getDepthImage(uint32_t imageIndex) const { return m_swapChain->getDepthImage(imageIndex); }
+	VkImageView getDepthImageView(uint32_t imageIndex) const { return m_swapChain->getDepthImageView(imageIndex); }
+	VkFormat getDepthFormat() const { return m_swapChain->getDepthFormat(); }
+
+	uint32_t getCurrentImageIndex() const
+	{
+		assert(m_isFrameStarted && "Cannot get image index when frame not in progress");
+		return m_currentImageIndex;
+	}
+
 	bool isFrameInProgress() const { return m_isFrameStarted; }
 
+	int getFramesInFlight() const { return m_framesInFlight; }
+
+	// Returns the latency of the frames that finished since the last call
+	LatencyStats takeLatencyStats();
+	// Returns the command pool overhead of the frames begun since the last call
+	CommandPoolStats takeCommandPoolStats();
+	// Returns the recording time of the frames begun since the last call
+	RecordingStats takeRecordingStats();
+
+	bool isMultithreadedRecording() const { return m_recordingThreads != nullptr; }
+	uint32_t getRecordingThreadCount() const { return isMultithreadedRecording() ? m_recordingThreads->getThreadCount() : 1; }
+
 	VkCommandBuffer getCurrentCommandBuffer() const 
 	{ 
 		assert(m_isFrameStarted && "Cannot get command buffer when frame not in progress");
-		return m_commandBuffers[m_currentFrameIndex];
+		return m_currentCommandBuffer;
 	}
 
 	int getFrameIndex() const 
@@ -48,11 +166,24 @@ public:
 	VkCommandBuffer beginFrame();
 	void endFrame();
 
-	void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+	void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, RenderPassMode mode = RenderPassMode::Clear);
+	void nextSwapChainSubpass(VkCommandBuffer commandBuffer);
 	void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+	// Pass nullptr to go back to recording everything inline on the calling thread
+	void setRecordingThreadPool(ThreadPool* threadPool);
+
+	// Records itemCount items into the swap chain render pass. Inline on the given command buffer by default, or split
+	// across the recording threads into secondary command buffers (which are then executed on the given command buffer)
+	void recordCommands(VkCommandBuffer commandBuffer, uint32_t itemCount, const RecordFunction& record);
+
 private:
 	void recreateSwapChain();
-	void createCommandBuffers();
-	void freeCommandBuffers();
+	void collectFinishedFrames();
+	void createFrameCommandPools();
+	void resetFrameCommandPools();
+	void createSecondaryCommandPools();
+	VkCommandBuffer beginSecondaryCommandBuffer(uint32_t threadIndex);
+	void recordCommandsOnThreads(VkCommandBuffer commandBuffer, uint32_t itemCount, const RecordFunction& record);
+	void setViewportAndScissor(VkCommandBuffer commandBuffer);
 };
\ No newline at end of file
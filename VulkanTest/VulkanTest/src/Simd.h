@@ -0,0 +1,12 @@
+#pragma once
+
+// SSE2 is part of every x64 target, on 32 bit x86 it depends on the /arch (MSVC) or -msse2 (gcc, clang) flag
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#else
+#define SIMD_SSE2 0
+#endif
+
+#if SIMD_SSE2
+#include <emmintrin.h>
+#endif
\ No newline at end of file
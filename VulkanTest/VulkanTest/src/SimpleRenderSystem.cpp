@@ -1,38 +1,89 @@
 #include "SimpleRenderSystem.h"
+#include "CpuProfiler.h"
 #include <stdexcept>
 #include <array>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
-// Vulkan only guarantees 128bytes of space for the push constant (that is 2x mat4)
-struct SimplePushConstantData
+// Matches the std430 layout of ObjectData in simple.vert
+struct ObjectData
 {
 	glm::mat4 modelMatrix{ 1.0f };
 	glm::mat4 normalMatrix{ 1.0f };
 };
 
-SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout): m_device(device)
+// Vulkan only guarantees 128bytes of space for the push constant, so only the index into the object buffer is pushed
+struct SimplePushConstantData
+{
+	uint32_t objectIndex = 0;
+};
+
+SimpleRenderSystem::SimpleRenderSystem(Device& device, PipelineCache& pipelineCache, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, int framesInFlight,
+	uint32_t maxObjects, TransformSource transformSource)
+	: m_device(device), m_framesInFlight(framesInFlight), m_pipelineCache(pipelineCache), m_maxObjects(maxObjects), m_transformSource(transformSource)
 {
+	createObjectBuffers();
 	createPipelineLayout(globalSetLayout);
 	createPipeline(renderPass);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem()
 {
-	vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr);
+	VkPipelineLayout pipelineLayout = m_pipelineLayout;
+	m_device.destroyDeferred([pipelineLayout](VkDevice device) { vkDestroyPipelineLayout(device, pipelineLayout, nullptr); });
+}
+
+void SimpleRenderSystem::createObjectBuffers()
+{
+	m_objectPool = DescriptorPool::Builder(m_device)
+		.setMaxSets(m_framesInFlight)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_framesInFlight)
+		.build();
+
+	m_objectSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+		.build();
+
+	m_objectBuffers.resize(m_framesInFlight);
+	m_objectDescriptorSets.resize(m_framesInFlight);
+	m_uploadedVersions.resize(m_framesInFlight, std::vector<uint32_t>(m_maxObjects, 0));
+	for (int i = 0; i < m_objectBuffers.size(); i++)
+	{
+		// The objects are indexed as one array in the shader, so they are tightly packed with the std430 array stride
+		// (a minOffsetAlignment would pad every element and break the indexing)
+		m_objectBuffers[i] = std::make_unique<Buffer>
+		(
+			m_device,
+			sizeof(ObjectData),
+			m_maxObjects,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		);
+
+		m_objectBuffers[i]->map();
+
+		auto bufferInfo = m_objectBuffers[i]->descriptorInfo();
+
+		DescriptorWriter(*m_objectSetLayout, *m_objectPool)
+			.writeBuffer(0, &bufferInfo)
+			.build(m_objectDescriptorSets[i]);
+	}
 }
 
 void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
 {
 	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(SimplePushConstantData);
+	pushConstantRange.size = m_transformSource == TransformSource::PushConstants ? sizeof(ObjectData) : sizeof(SimplePushConstantData);
 
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, m_objectSetLayout->getDescriptorSetLayout() };
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -48,48 +99,472 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
 	}
 }
 
+// Constant ids of simple.vert
+static constexpr uint32_t AMBIENT_CONSTANT_ID = 0;
+
+static void SetShaderConstants(PipelineConfigInfo& configInfo)
+{
+	configInfo.vertexSpecialization.set(AMBIENT_CONSTANT_ID, SimpleRenderSystem::AMBIENT);
+}
+
 void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
 {
 	assert(m_pipelineLayout != nullptr && "Cannot create pupeline before pipeline layout");
 
+	m_renderPass = renderPass;
+
 	PipelineConfigInfo pipelineConfig{};
-	Pipeline::DefaultPipelineConfigInfo(pipelineConfig);
+	createPipelineConfigInfo(pipelineConfig, renderPass);
+
+	m_pipeline = &m_pipelineCache.getPipeline(getVertexShaderFilePath(), "shaders/simple.frag.spv", pipelineConfig);
+}
+
+const char* SimpleRenderSystem::getVertexShaderFilePath() const
+{
+	return m_transformSource == TransformSource::PushConstants ? "shaders/simple_push.vert.spv" : "shaders/simple.vert.spv";
+}
+
+void SimpleRenderSystem::createPipelineConfigInfo(PipelineConfigInfo& configInfo, VkRenderPass renderPass) const
+{
+	Pipeline::DefaultPipelineConfigInfo(configInfo);
+
+	configInfo.renderPass = renderPass;
+	configInfo.pipelineLayout = m_pipelineLayout;
+	SetShaderConstants(configInfo);
+}
+
+Pipeline* SimpleRenderSystem::getCulledPipeline(Pipeline* pipeline, Pipeline*& culledPipeline, const std::string& vertexFilePath, const std::string& fragmentFilePath, PipelineConfigInfo& configInfo)
+{
+	if (culledPipeline == nullptr)
+	{
+		configInfo.rasterizationInfo.cullMode = m_cullMode;
+
+		Pipeline* variant = m_pipelineCache.requestPipeline(vertexFilePath, fragmentFilePath, configInfo, pipeline);
+		if (variant != pipeline)
+		{
+			culledPipeline = variant;
+		}
+
+		return variant;
+	}
+
+	return culledPipeline;
+}
+
+void SimpleRenderSystem::selectPipelines()
+{
+	if (m_cullMode == VK_CULL_MODE_NONE)
+	{
+		m_colorPipeline = m_pipeline;
+		m_frameDepthPrepassPipeline = m_depthPrepassPipeline;
+		m_frameDepthPrepassColorPipeline = m_depthPrepassColorPipeline;
+		return;
+	}
+
+	PipelineConfigInfo culledConfig{};
+	if (m_culledPipeline == nullptr)
+	{
+		createPipelineConfigInfo(culledConfig, m_renderPass);
+	}
+
+	m_colorPipeline = getCulledPipeline(m_pipeline, m_culledPipeline, getVertexShaderFilePath(), "shaders/simple.frag.spv", culledConfig);
+
+	if (m_depthPrepassPipeline == nullptr)
+	{
+		return;
+	}
+
+	PipelineConfigInfo culledDepthConfig{};
+	if (m_culledDepthPrepassPipeline == nullptr)
+	{
+		createDepthPrepassConfigInfo(culledDepthConfig);
+	}
+
+	PipelineConfigInfo culledColorConfig{};
+	if (m_culledDepthPrepassColorPipeline == nullptr)
+	{
+		createDepthPrepassColorConfigInfo(culledColorConfig);
+	}
 
-	pipelineConfig.renderPass = renderPass;
-	pipelineConfig.pipelineLayout = m_pipelineLayout;
+	Pipeline* depthPipeline = getCulledPipeline(m_depthPrepassPipeline, m_culledDepthPrepassPipeline, "shaders/depth_prepass.vert.spv", "", culledDepthConfig);
+	Pipeline* colorPipeline = getCulledPipeline(m_depthPrepassColorPipeline, m_culledDepthPrepassColorPipeline, "shaders/simple.vert.spv", "shaders/simple.frag.spv", culledColorConfig);
 
-	m_pipeline = std::make_unique<Pipeline>(m_device, "shaders/simple.vert.spv", "shaders/simple.frag.spv", pipelineConfig);
+	// Both subpasses have to cull the same faces, so the culled pair is only used once both of them are compiled
+	bool culled = depthPipeline != m_depthPrepassPipeline && colorPipeline != m_depthPrepassColorPipeline;
+	m_frameDepthPrepassPipeline = culled ? depthPipeline : m_depthPrepassPipeline;
+	m_frameDepthPrepassColorPipeline = culled ? colorPipeline : m_depthPrepassColorPipeline;
 }
 
-void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, std::vector<GameObject>& gameObjects)
+void SimpleRenderSystem::setCullMode(VkCullModeFlags cullMode)
 {
-	m_pipeline->bind(frameInfo.commandBuffer);
+	m_cullMode = cullMode;
+	m_culledPipeline = nullptr;
+	m_culledDepthPrepassPipeline = nullptr;
+	m_culledDepthPrepassColorPipeline = nullptr;
+}
+
+void SimpleRenderSystem::setRenderPasses(VkRenderPass renderPass, VkRenderPass depthPrepassRenderPass)
+{
+	bool depthPrepass = isDepthPrepassEnabled();
 
-	vkCmdBindDescriptorSets(
-		frameInfo.commandBuffer,
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_pipelineLayout,
-		0,
-		1,
-		&frameInfo.globalDescriptorSet,
-		0,
-		nullptr);
+	// Including the variants that are still being compiled, which can't use the old render passes anymore
+	m_pipelineCache.dropRenderPass(m_renderPass);
+	m_pipelineCache.dropRenderPass(m_depthPrepassRenderPass);
+	m_culledPipeline = nullptr;
+
+	createPipeline(renderPass);
+	setDepthPrepass(depthPrepass, depthPrepassRenderPass);
+}
 
-	for (auto& obj : gameObjects)
+void SimpleRenderSystem::prepareEntities(FrameInfo& frameInfo, Registry& registry, const TransformSystem& transformSystem, const SpatialIndex& spatialIndex)
+{
+	PROFILE_ZONE("SimpleRenderSystem::prepareEntities");
+
+	// Picked once per frame, before the draws get recorded (possibly on other threads)
+	selectPipelines();
+
+	ComponentPool<MeshComponent>& meshes = registry.getPool<MeshComponent>();
+	ComponentPool<OccluderComponent>& occluders = registry.getPool<OccluderComponent>();
+	glm::mat4 viewProjection = frameInfo.camera.getProjectionMatrix() * frameInfo.camera.getViewMatrix();
+	Frustum frustum = Frustum::FromViewProjection(viewProjection);
+
+	if (m_occlusionCuller != nullptr)
 	{
+		m_occlusionCuller->beginFrame(viewProjection);
+		registry.each<OccluderComponent, TransformHandleComponent>([&](Entity, OccluderComponent& occluder, TransformHandleComponent& transform)
+		{
+			m_occlusionCuller->addOccluder(*occluder.mesh, transformSystem.getModelMatrix(transform.transformId));
+		});
+		m_occlusionCuller->rasterize(m_occlusionThreadPool);
+	}
+
+	m_visibleObjects.clear();
+	spatialIndex.queryFrustum(frustum, [&](const SpatialIndex::Entry& entry)
+	{
+		// Tested with the (slightly larger) bounds stored in the BVH, which are already world space. Occluders are not
+		// tested, they would only be hidden by other occluders which they are usually part of
+		const AABB& bounds = spatialIndex.getBvh().getFatBounds(entry.proxy);
+		if (m_occlusionCuller != nullptr && !occluders.has(entry.entity) && m_occlusionCuller->isOccluded(bounds))
+		{
+			return;
+		}
+
+		m_visibleObjects.push_back(VisibleObject{ meshes.get(entry.entity).model, entry.transformId, bounds });
+	});
+
+	if (m_gpuOcclusionCuller != nullptr)
+	{
+		prepareGpuCulling(frameInfo, transformSystem, viewProjection);
+	}
+}
+
+void SimpleRenderSystem::prepareGpuCulling(FrameInfo& frameInfo, const TransformSystem& transformSystem, const glm::mat4& viewProjection)
+{
+	// Every model gets one indirect draw call over a range of commands, so objects sharing a model have to be next
+	// to each other
+	std::sort(m_visibleObjects.begin(), m_visibleObjects.end(), [](const VisibleObject& a, const VisibleObject& b)
+	{
+		return a.model != b.model ? a.model < b.model : a.transformId < b.transformId;
+	});
+
+	GpuOcclusionCuller::CullObject* cullObjects = m_gpuOcclusionCuller->getCullObjects(frameInfo.frameIndex);
+	bool anyUploaded = false;
+
+	m_drawRuns.clear();
+	for (uint32_t i = 0; i < m_visibleObjects.size(); i++)
+	{
+		const VisibleObject& object = m_visibleObjects[i];
+
+		// Objects can be drawn in either phase, so all of them are uploaded up front
+		anyUploaded |= writeObjectData(frameInfo.frameIndex, transformSystem, object.transformId);
+
+		GpuOcclusionCuller::CullObject& cullObject = cullObjects[i];
+		cullObject.boundsMin = object.bounds.min;
+		cullObject.objectIndex = object.transformId;
+		cullObject.boundsMax = object.bounds.max;
+		cullObject.count = object.model->getDrawCount();
+		cullObject.indexed = object.model->hasIndexBuffer() ? 1 : 0;
+
+		if (m_drawRuns.empty() || m_drawRuns.back().model != object.model)
+		{
+			m_drawRuns.push_back(DrawRun{ object.model, i, 0 });
+		}
+
+		m_drawRuns.back().drawCount++;
+	}
+
+	if (anyUploaded)
+	{
+		m_objectBuffers[frameInfo.frameIndex]->flush();
+	}
+
+	m_viewProjection = viewProjection;
+	m_gpuOcclusionCuller->cullEarly(frameInfo, static_cast<uint32_t>(m_visibleObjects.size()), m_viewProjection);
+}
+
+void SimpleRenderSystem::renderEntityDepth(FrameInfo& frameInfo, const TransformSystem& transformSystem)
+{
+	PROFILE_ZONE("SimpleRenderSystem::renderEntityDepth");
+
+	assert(m_depthPrepassPipeline != nullptr && "Cannot render entity depth without the depth pre-pass");
+
+	if (m_gpuOcclusionCuller != nullptr)
+	{
+		recordDrawRuns(frameInfo, GpuOcclusionCuller::Phase::Early, *m_frameDepthPrepassPipeline, true);
+		return;
+	}
+
+	recordVisibleObjects(frameInfo, transformSystem, *m_frameDepthPrepassPipeline, true);
+}
+
+void SimpleRenderSystem::renderEntities(FrameInfo& frameInfo, const TransformSystem& transformSystem)
+{
+	PROFILE_ZONE("SimpleRenderSystem::renderEntities");
+
+	Pipeline& pipeline = m_depthPrepassPipeline != nullptr ? *m_frameDepthPrepassColorPipeline : *m_colorPipeline;
+
+	if (m_gpuOcclusionCuller != nullptr)
+	{
+		recordDrawRuns(frameInfo, GpuOcclusionCuller::Phase::Early, pipeline, false);
+		return;
+	}
+
+	recordVisibleObjects(frameInfo, transformSystem, pipeline, false);
+}
+
+void SimpleRenderSystem::recordVisibleObjects(FrameInfo& frameInfo, const TransformSystem& transformSystem, Pipeline& pipeline, bool positionsOnly)
+{
+	Buffer& objectBuffer = *m_objectBuffers[frameInfo.frameIndex];
+	std::atomic<bool> anyUploaded{ false };
+	VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, m_objectDescriptorSets[frameInfo.frameIndex] };
+
+	// Can be called from several recording threads at once, each with its own command buffer and range of objects
+	auto record = [&](VkCommandBuffer commandBuffer, uint32_t firstObject, uint32_t objectCount)
+	{
+		pipeline.bind(commandBuffer);
+
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_pipelineLayout,
+			0,
+			2,
+			descriptorSets,
+			1,
+			&frameInfo.globalUboOffset);
+
+		for (uint32_t i = firstObject; i < firstObject + objectCount; i++)
+		{
+			Model* model = m_visibleObjects[i].model;
+			uint32_t objectIndex = m_visibleObjects[i].transformId;
+
+			if (m_transformSource == TransformSource::PushConstants)
+			{
+				ObjectData objectData{};
+				objectData.modelMatrix = transformSystem.getModelMatrix(objectIndex);
+				objectData.normalMatrix = transformSystem.getNormalMatrix(objectIndex);
+
+				vkCmdPushConstants(
+					commandBuffer,
+					m_pipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					sizeof(ObjectData),
+					&objectData);
+			}
+			else
+			{
+				// With a depth pre-pass this already happens while recording the depth, so the color pass finds
+				// everything up to date
+				if (writeObjectData(frameInfo.frameIndex, transformSystem, objectIndex))
+				{
+					anyUploaded.store(true, std::memory_order_relaxed);
+				}
+
+				SimplePushConstantData push{};
+				push.objectIndex = objectIndex;
+
+				vkCmdPushConstants(
+					commandBuffer,
+					m_pipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					sizeof(SimplePushConstantData),
+					&push);
+			}
+
+			if (positionsOnly)
+			{
+				model->bindPositions(commandBuffer);
+			}
+			else
+			{
+				model->bind(commandBuffer);
+			}
+			model->draw(commandBuffer);
+		}
+	};
+
+	frameInfo.renderer.recordCommands(frameInfo.commandBuffer, static_cast<uint32_t>(m_visibleObjects.size()), record);
+
+	// Make the object data written this frame visible to the device before the frame gets submitted
+	if (anyUploaded.load(std::memory_order_relaxed))
+	{
+		objectBuffer.flush();
+	}
+}
+
+void SimpleRenderSystem::cullOccludedEntities(FrameInfo& frameInfo)
+{
+	PROFILE_ZONE("SimpleRenderSystem::cullOccludedEntities");
+
+	assert(m_gpuOcclusionCuller != nullptr && "Cannot cull occluded entities without GPU occlusion culling");
+
+	m_gpuOcclusionCuller->cullLate(frameInfo, static_cast<uint32_t>(m_visibleObjects.size()), m_viewProjection);
+}
+
+void SimpleRenderSystem::renderNewlyVisibleEntities(FrameInfo& frameInfo)
+{
+	PROFILE_ZONE("SimpleRenderSystem::renderNewlyVisibleEntities");
+
+	assert(m_gpuOcclusionCuller != nullptr && "Cannot render newly visible entities without GPU occlusion culling");
+
+	// Drawn in a render pass without a depth pre-pass, the newly visible objects are only a small part of the frame
+	recordDrawRuns(frameInfo, GpuOcclusionCuller::Phase::Late, *m_colorPipeline, false);
+}
+
+void SimpleRenderSystem::recordDrawRuns(FrameInfo& frameInfo, GpuOcclusionCuller::Phase phase, Pipeline& pipeline, bool positionsOnly)
+{
+	VkBuffer drawCommands = m_gpuOcclusionCuller->getDrawCommands(frameInfo.frameIndex, phase);
+	VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, m_objectDescriptorSets[frameInfo.frameIndex] };
+
+	auto record = [&](VkCommandBuffer commandBuffer, uint32_t firstRun, uint32_t runCount)
+	{
+		pipeline.bind(commandBuffer);
+
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_pipelineLayout,
+			0,
+			2,
+			descriptorSets,
+			1,
+			&frameInfo.globalUboOffset);
+
+		// The object index comes from the first instance of every command, so nothing is added to it
 		SimplePushConstantData push{};
-		push.modelMatrix = obj.transform.getTransformationMatrix();
-		push.normalMatrix = obj.transform.getNormalMatrix();
+		push.objectIndex = 0;
 
 		vkCmdPushConstants(
-			frameInfo.commandBuffer,
+			commandBuffer,
 			m_pipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			VK_SHADER_STAGE_VERTEX_BIT,
 			0,
 			sizeof(SimplePushConstantData),
 			&push);
 
-		obj.model->bind(frameInfo.commandBuffer);
-		obj.model->draw(frameInfo.commandBuffer);
+		for (uint32_t i = firstRun; i < firstRun + runCount; i++)
+		{
+			const DrawRun& run = m_drawRuns[i];
+			VkDeviceSize offset = static_cast<VkDeviceSize>(run.firstDraw) * GpuOcclusionCuller::DRAW_COMMAND_STRIDE;
+
+			if (positionsOnly)
+			{
+				run.model->bindPositions(commandBuffer);
+			}
+			else
+			{
+				run.model->bind(commandBuffer);
+			}
+			run.model->drawIndirect(commandBuffer, drawCommands, offset, run.drawCount, GpuOcclusionCuller::DRAW_COMMAND_STRIDE);
+		}
+	};
+
+	frameInfo.renderer.recordCommands(frameInfo.commandBuffer, static_cast<uint32_t>(m_drawRuns.size()), record);
+}
+
+bool SimpleRenderSystem::writeObjectData(int frameIndex, const TransformSystem& transformSystem, uint32_t objectIndex)
+{
+	assert(objectIndex < m_maxObjects && "Object index is out of the range of the object buffer");
+
+	uint32_t version = transformSystem.getVersion(objectIndex);
+	uint32_t& uploadedVersion = m_uploadedVersions[frameIndex][objectIndex];
+	if (uploadedVersion == version)
+	{
+		return false;
+	}
+
+	ObjectData objectData{};
+	objectData.modelMatrix = transformSystem.getModelMatrix(objectIndex);
+	objectData.normalMatrix = transformSystem.getNormalMatrix(objectIndex);
+	m_objectBuffers[frameIndex]->writeToIndex(&objectData, objectIndex);
+
+	uploadedVersion = version;
+	return true;
+}
+
+void SimpleRenderSystem::setOcclusionCulling(bool enabled, ThreadPool* threadPool)
+{
+	m_occlusionCuller = enabled ? std::make_unique<OcclusionCuller>() : nullptr;
+	m_occlusionThreadPool = threadPool;
+}
+
+void SimpleRenderSystem::setDepthPrepass(bool enabled, VkRenderPass depthPrepassRenderPass)
+{
+	m_depthPrepassRenderPass = VK_NULL_HANDLE;
+	m_depthPrepassPipeline = nullptr;
+	m_depthPrepassColorPipeline = nullptr;
+	m_culledDepthPrepassPipeline = nullptr;
+	m_culledDepthPrepassColorPipeline = nullptr;
+
+	if (!enabled)
+	{
+		return;
 	}
+
+	assert(depthPrepassRenderPass != VK_NULL_HANDLE && "Cannot enable the depth pre-pass without its render pass");
+	assert(m_transformSource == TransformSource::StorageBuffer && "Cannot use the depth pre-pass with pushed transforms");
+
+	m_depthPrepassRenderPass = depthPrepassRenderPass;
+
+	PipelineConfigInfo depthConfig{};
+	createDepthPrepassConfigInfo(depthConfig);
+	m_depthPrepassPipeline = &m_pipelineCache.getPipeline("shaders/depth_prepass.vert.spv", "", depthConfig);
+
+	PipelineConfigInfo colorConfig{};
+	createDepthPrepassColorConfigInfo(colorConfig);
+	m_depthPrepassColorPipeline = &m_pipelineCache.getPipeline("shaders/simple.vert.spv", "shaders/simple.frag.spv", colorConfig);
+}
+
+void SimpleRenderSystem::createDepthPrepassConfigInfo(PipelineConfigInfo& configInfo) const
+{
+	Pipeline::DefaultPipelineConfigInfo(configInfo);
+	configInfo.renderPass = m_depthPrepassRenderPass;
+	configInfo.subpass = 0;
+	configInfo.pipelineLayout = m_pipelineLayout;
+	configInfo.bindingDescriptions = Model::Vertex::getPositionBindingDescriptions();
+	configInfo.attributeDescriptions = Model::Vertex::getPositionAttributeDescriptions();
+	configInfo.colorBlendInfo.attachmentCount = 0;
+	configInfo.colorBlendInfo.pAttachments = nullptr;
+}
+
+void SimpleRenderSystem::createDepthPrepassColorConfigInfo(PipelineConfigInfo& configInfo) const
+{
+	// Every visible fragment has exactly the depth of the pre-pass, so anything behind it gets rejected before the
+	// fragment shader runs and nothing has to be written
+	Pipeline::DefaultPipelineConfigInfo(configInfo);
+	configInfo.renderPass = m_depthPrepassRenderPass;
+	configInfo.subpass = 1;
+	configInfo.pipelineLayout = m_pipelineLayout;
+	configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+	configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	SetShaderConstants(configInfo);
 }
+
+void SimpleRenderSystem::setGpuOcclusionCulling(bool enabled)
+{
+	assert((!enabled || m_transformSource == TransformSource::StorageBuffer) && "Cannot use GPU occlusion culling with pushed transforms");
+
+	m_gpuOcclusionCuller = enabled ? std::make_unique<GpuOcclusionCuller>(m_device, m_framesInFlight, m_maxObjects, m_maxObjects) : nullptr;
+}
\ No newline at end of file
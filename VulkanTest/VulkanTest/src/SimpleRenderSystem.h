@@ -2,31 +2,178 @@
 
 #include "Camera.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
 #include "Device.h"
-#include "GameObject.h"
+#include "Registry.h"
+#include "Components.h"
+#include "TransformSystem.h"
+#include "SpatialIndex.h"
+#include "OcclusionCuller.h"
+#include "GpuOcclusionCuller.h"
+#include "ThreadPool.h"
 #include "FrameInfo.h"
+#include "Buffer.h"
+#include "Descriptor.h"
 
 #include <memory>
 #include <vector>
 
 class SimpleRenderSystem
 {
+public:
+	static constexpr uint32_t DEFAULT_MAX_OBJECTS = 10000;
+	// Light every surface gets, compiled into the shaders as a specialization constant
+	static constexpr float AMBIENT = 0.02f;
+
+	// How the transforms of the objects get to the vertex shader
+	enum class TransformSource
+	{
+		// Written to the object buffer when they changed, only the index of the object is pushed with every draw
+		StorageBuffer,
+		// Both matrices are pushed with every draw, only kept to compare against the object buffer. Doesn't work
+		// with the depth pre-pass or GPU occlusion culling, which need the object buffer
+		PushConstants
+	};
+
 private:
 	Device& m_device;
+	int m_framesInFlight;
 
-	std::unique_ptr<Pipeline> m_pipeline;
+	// The pipelines are owned by the cache
+	PipelineCache& m_pipelineCache;
+	Pipeline* m_pipeline = nullptr;
 	VkPipelineLayout m_pipelineLayout;
 
+	// Only set when the depth pre-pass is enabled. The depth pipeline only reads the position stream of the models,
+	// the color pipeline then tests against that depth without writing it
+	Pipeline* m_depthPrepassPipeline = nullptr;
+	Pipeline* m_depthPrepassColorPipeline = nullptr;
+
+	// Variants of the pipelines with face culling, compiled in the background the first time they're needed. Until
+	// then the pipelines without culling draw the same image
+	VkRenderPass m_renderPass;
+	VkRenderPass m_depthPrepassRenderPass = VK_NULL_HANDLE;
+	VkCullModeFlags m_cullMode = VK_CULL_MODE_NONE;
+	Pipeline* m_culledPipeline = nullptr;
+	Pipeline* m_culledDepthPrepassPipeline = nullptr;
+	Pipeline* m_culledDepthPrepassColorPipeline = nullptr;
+	// The pipelines the passes draw with this frame, picked by prepareEntities
+	Pipeline* m_colorPipeline = nullptr;
+	Pipeline* m_frameDepthPrepassPipeline = nullptr;
+	Pipeline* m_frameDepthPrepassColorPipeline = nullptr;
+
+	// Per object data lives in a storage buffer (one for every frame in flight) which the vertex shader indexes,
+	// so the only thing pushed per draw is the index of the object
+	uint32_t m_maxObjects;
+	TransformSource m_transformSource;
+	std::unique_ptr<DescriptorPool> m_objectPool;
+	std::unique_ptr<DescriptorSetLayout> m_objectSetLayout;
+	std::vector<std::unique_ptr<Buffer>> m_objectBuffers;
+	std::vector<VkDescriptorSet> m_objectDescriptorSets;
+
+	// Transform version of every object as it was last written to the object buffer of that frame, objects are
+	// stored at their transform id so unchanged objects keep their data and are not uploaded again
+	std::vector<std::vector<uint32_t>> m_uploadedVersions;
+
+	struct VisibleObject
+	{
+		Model* model;
+		TransformSystem::id_t transformId;
+		AABB bounds;
+	};
+
+	std::vector<VisibleObject> m_visibleObjects;
+
+	// Only created when occlusion culling is enabled
+	std::unique_ptr<OcclusionCuller> m_occlusionCuller;
+	ThreadPool* m_occlusionThreadPool = nullptr;
+
+	// Only created when GPU occlusion culling is enabled. The visible objects are then sorted by model, so every model
+	// is one indirect draw over the range of draw commands of its objects
+	std::unique_ptr<GpuOcclusionCuller> m_gpuOcclusionCuller;
+
+	struct DrawRun
+	{
+		Model* model;
+		uint32_t firstDraw;
+		uint32_t drawCount;
+	};
+
+	std::vector<DrawRun> m_drawRuns;
+	glm::mat4 m_viewProjection{ 1.0f };
+
 public:
-	SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+	// framesInFlight has to match the renderer, every frame in flight gets its own object buffer. The pipeline cache has
+	// to outlive the render system
+	SimpleRenderSystem(Device& device, PipelineCache& pipelineCache, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, int framesInFlight,
+		uint32_t maxObjects = DEFAULT_MAX_OBJECTS, TransformSource transformSource = TransformSource::StorageBuffer);
 	~SimpleRenderSystem();
 
 	SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 	SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-	void renderGameObjects(FrameInfo& frameInfo, std::vector<GameObject>& gameObjects);
+	// Finds every entity that has a MeshComponent and a TransformHandleComponent and is inside the view frustum (and
+	// not hidden behind an occluder when occlusion culling is enabled). Has to be recorded outside of a render pass,
+	// because with GPU occlusion culling this already culls the objects for renderEntities
+	void prepareEntities(FrameInfo& frameInfo, Registry& registry, const TransformSystem& transformSystem, const SpatialIndex& spatialIndex);
+
+	// Depth pre-pass only. Writes the depth of the prepared entities in the depth only subpass of the render pass,
+	// after which renderEntities draws them in the next subpass
+	void renderEntityDepth(FrameInfo& frameInfo, const TransformSystem& transformSystem);
+
+	// Draws the prepared entities, with GPU occlusion culling only the ones that were visible last frame
+	void renderEntities(FrameInfo& frameInfo, const TransformSystem& transformSystem);
+
+	// GPU occlusion culling only. Tests the prepared entities against the depth drawn by renderEntities (outside of
+	// a render pass), after which renderNewlyVisibleEntities draws the ones that were missing in a render pass that
+	// continues on the one of renderEntities
+	void cullOccludedEntities(FrameInfo& frameInfo);
+	void renderNewlyVisibleEntities(FrameInfo& frameInfo);
+
+	// Amount of objects that passed frustum culling (and CPU occlusion culling) in the last prepareEntities
+	size_t getVisibleCount() const { return m_visibleObjects.size(); }
+
+	// Rasterizes the entities with an OccluderComponent on the CPU before drawing and skips the objects behind them.
+	// The thread pool is used to rasterize the tiles in parallel and can be null
+	void setOcclusionCulling(bool enabled, ThreadPool* threadPool = nullptr);
+	bool isOcclusionCullingEnabled() const { return m_occlusionCuller != nullptr; }
+
+	// Only valid when occlusion culling is enabled, for the last prepareEntities
+	const OcclusionCuller::Stats& getOcclusionStats() const { return m_occlusionCuller->getStats(); }
+
+	// The render pass is the one of Renderer::getSwapChainDepthPrepassRenderPass, which then has to be used with
+	// Renderer::RenderPassMode::DepthPrepass for every frame
+	void setDepthPrepass(bool enabled, VkRenderPass depthPrepassRenderPass = VK_NULL_HANDLE);
+	bool isDepthPrepassEnabled() const { return m_depthPrepassPipeline != nullptr; }
+
+	// Also culls in both subpasses of the depth pre-pass
+	void setCullMode(VkCullModeFlags cullMode);
+
+	// Has to be called between frames when the swap chain got recreated, before its old render passes are destroyed.
+	// Every pipeline is created again for the new render passes
+	void setRenderPasses(VkRenderPass renderPass, VkRenderPass depthPrepassRenderPass);
+
+	// Culls against a depth pyramid on the GPU, which needs the frame to be rendered as described at cullOccludedEntities
+	void setGpuOcclusionCulling(bool enabled);
+	bool isGpuOcclusionCullingEnabled() const { return m_gpuOcclusionCuller != nullptr; }
 
 private:
+	void prepareGpuCulling(FrameInfo& frameInfo, const TransformSystem& transformSystem, const glm::mat4& viewProjection);
+	void recordVisibleObjects(FrameInfo& frameInfo, const TransformSystem& transformSystem, Pipeline& pipeline, bool positionsOnly);
+	void recordDrawRuns(FrameInfo& frameInfo, GpuOcclusionCuller::Phase phase, Pipeline& pipeline, bool positionsOnly);
+
+	// Writes the object data of a transform to the object buffer of the frame, unless it's already up to date
+	bool writeObjectData(int frameIndex, const TransformSystem& transformSystem, uint32_t objectIndex);
+
+	void createObjectBuffers();
 	void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 	void createPipeline(VkRenderPass renderPass);
+	void createPipelineConfigInfo(PipelineConfigInfo& configInfo, VkRenderPass renderPass) const;
+	const char* getVertexShaderFilePath() const;
+	void createDepthPrepassConfigInfo(PipelineConfigInfo& configInfo) const;
+	void createDepthPrepassColorConfigInfo(PipelineConfigInfo& configInfo) const;
+
+	// Returns the pipeline until its culled variant (created from the config) is compiled
+	Pipeline* getCulledPipeline(Pipeline* pipeline, Pipeline*& culledPipeline, const std::string& vertexFilePath, const std::string& fragmentFilePath, PipelineConfigInfo& configInfo);
+	void selectPipelines();
 };
\ No newline at end of file
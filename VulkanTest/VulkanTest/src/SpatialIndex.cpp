@@ -0,0 +1,117 @@
+#include "SpatialIndex.h"
+#include "CpuProfiler.h"
+
+void SpatialIndex::update(Registry& registry, const TransformSystem& transformSystem)
+{
+	PROFILE_ZONE("SpatialIndex::update");
+
+	const auto& meshes = registry.getPool<MeshComponent>();
+	const auto& transforms = registry.getPool<TransformHandleComponent>();
+
+	if (!m_synced || meshes.getStructureVersion() != m_meshVersion || transforms.getStructureVersion() != m_transformVersion)
+	{
+		syncEntities(registry, transformSystem);
+
+		m_meshVersion = meshes.getStructureVersion();
+		m_transformVersion = transforms.getStructureVersion();
+		m_synced = true;
+	}
+
+	for (TransformSystem::id_t transformId : transformSystem.getChangedIds())
+	{
+		if (transformId < m_entryOfTransform.size() && m_entryOfTransform[transformId] != INVALID_ENTRY)
+		{
+			uint32_t entry = m_entryOfTransform[transformId];
+			m_bvh.moveProxy(m_entries[entry].proxy, getWorldBounds(entry, transformSystem));
+		}
+	}
+
+	m_bvh.optimize();
+}
+
+void SpatialIndex::syncEntities(Registry& registry, const TransformSystem& transformSystem)
+{
+	auto& meshes = registry.getPool<MeshComponent>();
+	auto& transforms = registry.getPool<TransformHandleComponent>();
+
+	std::vector<bool> seen(m_entries.size(), false);
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		Entity entity = meshes.getEntity(i);
+		const TransformHandleComponent* transform = transforms.tryGet(entity);
+		if (transform == nullptr || meshes[i].model == nullptr)
+		{
+			continue;
+		}
+
+		TransformSystem::id_t transformId = transform->transformId;
+		if (transformId >= m_entryOfTransform.size())
+		{
+			m_entryOfTransform.resize(transformId + 1, INVALID_ENTRY);
+		}
+
+		uint32_t entry = m_entryOfTransform[transformId];
+		if (entry != INVALID_ENTRY && m_entries[entry].entity == entity)
+		{
+			seen[entry] = true;
+			continue;
+		}
+
+		if (entry != INVALID_ENTRY)
+		{
+			// The transform moved to another entity, the old entry gets removed below
+			m_entryOfTransform[transformId] = INVALID_ENTRY;
+		}
+
+		entry = static_cast<uint32_t>(m_entries.size());
+		m_entries.push_back(Entry{ entity, transformId, BoundingVolumeHierarchy::NULL_NODE });
+		m_localBounds.push_back(meshes[i].model->getBounds());
+		m_entryOfTransform[transformId] = entry;
+		seen.push_back(true);
+
+		// Inserted into the tree by the optimize at the end of the update (which rebuilds when many got added at once)
+		m_entries[entry].proxy = m_bvh.createProxy(getWorldBounds(entry, transformSystem), entry, true);
+	}
+
+	// Backwards, so the entries that get swapped into a removed spot have already been checked
+	for (size_t i = seen.size(); i-- > 0;)
+	{
+		if (!seen[i])
+		{
+			removeEntry(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+void SpatialIndex::removeEntry(uint32_t entry)
+{
+	Entry& removed = m_entries[entry];
+	m_bvh.destroyProxy(removed.proxy);
+
+	if (m_entryOfTransform[removed.transformId] == entry)
+	{
+		m_entryOfTransform[removed.transformId] = INVALID_ENTRY;
+	}
+
+	uint32_t last = static_cast<uint32_t>(m_entries.size() - 1);
+	if (entry != last)
+	{
+		m_entries[entry] = m_entries[last];
+		m_localBounds[entry] = m_localBounds[last];
+		m_bvh.setUserData(m_entries[entry].proxy, entry);
+
+		if (m_entryOfTransform[m_entries[entry].transformId] == last)
+		{
+			m_entryOfTransform[m_entries[entry].transformId] = entry;
+		}
+	}
+
+	m_entries.pop_back();
+	m_localBounds.pop_back();
+}
+
+AABB SpatialIndex::getWorldBounds(uint32_t entry, const TransformSystem& transformSystem) const
+{
+	return m_localBounds[entry].transformed(transformSystem.getModelMatrix(m_entries[entry].transformId));
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "BoundingVolumeHierarchy.h"
+#include "Registry.h"
+#include "Components.h"
+#include "TransformSystem.h"
+
+#include <limits>
+#include <vector>
+
+// Keeps a BoundingVolumeHierarchy over the world bounds of every entity with a MeshComponent and a
+// TransformHandleComponent. Entities are only resynced when one of those pools changed, and bounds are only
+// updated for the transforms that changed in the last TransformSystem::update, so a static scene costs nothing.
+// The bounds use the model the entity had when it was added, replace the MeshComponent to change the model
+class SpatialIndex
+{
+public:
+	static constexpr uint32_t INVALID_ENTRY = std::numeric_limits<uint32_t>::max();
+
+	struct Entry
+	{
+		Entity entity;
+		TransformSystem::id_t transformId;
+		uint32_t proxy;
+	};
+
+private:
+	BoundingVolumeHierarchy m_bvh;
+
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_entryOfTransform;
+	std::vector<AABB> m_localBounds;
+
+	uint32_t m_meshVersion = 0;
+	uint32_t m_transformVersion = 0;
+	bool m_synced = false;
+
+public:
+	SpatialIndex() = default;
+
+	SpatialIndex(const SpatialIndex&) = delete;
+	SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+	// Has to be called after every TransformSystem::update
+	void update(Registry& registry, const TransformSystem& transformSystem);
+
+	const BoundingVolumeHierarchy& getBvh() const { return m_bvh; }
+	size_t size() const { return m_entries.size(); }
+
+	template<typename Function>
+	void queryFrustum(const Frustum& frustum, Function&& callback) const
+	{
+		m_bvh.queryFrustum(frustum, [&](uint32_t entry) { callback(m_entries[entry]); });
+	}
+
+	template<typename Function>
+	void querySphere(const glm::vec3& center, float radius, Function&& callback) const
+	{
+		m_bvh.querySphere(center, radius, [&](uint32_t entry) { callback(m_entries[entry]); });
+	}
+
+	template<typename Function>
+	void queryAABB(const AABB& bounds, Function&& callback) const
+	{
+		m_bvh.queryAABB(bounds, [&](uint32_t entry) { callback(m_entries[entry]); });
+	}
+
+	// The callback gets (entry, maxDistance) and returns the new max distance, see BoundingVolumeHierarchy::raycast
+	template<typename Function>
+	void raycast(const Ray& ray, float maxDistance, Function&& callback) const
+	{
+		m_bvh.raycast(ray, maxDistance, [&](uint32_t entry, float distance) { return callback(m_entries[entry], distance); });
+	}
+
+private:
+	void syncEntities(Registry& registry, const TransformSystem& transformSystem);
+	void removeEntry(uint32_t entry);
+	AABB getWorldBounds(uint32_t entry, const TransformSystem& transformSystem) const;
+};
\ No newline at end of file
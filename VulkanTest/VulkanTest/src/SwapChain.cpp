@@ -1,6 +1,8 @@
 #include "SwapChain.h"
+#include "CpuProfiler.h"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -9,25 +11,42 @@
 #include <set>
 #include <stdexcept>
 
-SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent)
-    : device{ deviceRef }, windowExtent{ extent } {
+SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, int framesInFlight)
+    : device{ deviceRef }, windowExtent{ extent }, offscreen{ deviceRef.isHeadless() }, framesInFlight{ framesInFlight } {
+    if (framesInFlight < MIN_FRAMES_IN_FLIGHT || framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+        throw std::runtime_error("frames in flight out of range!");
+    }
+
     init();
 }
 
 SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-    : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{previous}
+    : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{previous}, offscreen{ previous->offscreen },
+    framesInFlight{ previous->framesInFlight },
+    currentFrame{ previous->currentFrame }
 {
+    // The frames still in flight on the previous swap chain signal these fences, so waiting on them keeps working
+    // across the switch. The previous swap chain keeps its semaphores and can be destroyed once those frames are done
+    inFlightFences = std::move(previous->inFlightFences);
+    previous->inFlightFences.clear();
+    frameTimelineValues = previous->frameTimelineValues;
+
     init();
 
-    // Clean up old swap chain since it's no longer needed
+    // The previous swap chain is retired by the owner, which knows when it's no longer in use
     oldSwapChain = nullptr;
 }
 
 void SwapChain::init()
 {
-    createSwapChain();
+    if (offscreen) {
+        createOffscreenImages();
+    }
+    else {
+        createSwapChain();
+    }
     createImageViews();
-    createRenderPass();
+    createRenderPasses();
     createDepthResources();
     createFramebuffers();
     createSyncObjects();
@@ -44,6 +63,12 @@ SwapChain::~SwapChain() {
         swapChain = nullptr;
     }
 
+    // Only the offscreen images are owned, the swap chain images are destroyed together with the swap chain
+    for (int i = 0; i < offscreenImageMemorys.size(); i++) {
+        vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+        vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+    }
+
     for (int i = 0; i < depthImages.size(); i++) {
         vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
         vkDestroyImage(device.device(), depthImages[i], nullptr);
@@ -54,23 +79,46 @@ SwapChain::~SwapChain() {
         vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
     }
 
+    for (auto framebuffer : depthPrepassFramebuffers) {
+        vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    }
+
     vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    vkDestroyRenderPass(device.device(), loadRenderPass, nullptr);
+    vkDestroyRenderPass(device.device(), depthPrepassRenderPass, nullptr);
 
     // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (int i = 0; i < framesInFlight; i++) {
         vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+    }
+
+    // Empty when a newer swap chain took them over
+    for (auto fence : inFlightFences) {
+        vkDestroyFence(device.device(), fence, nullptr);
     }
 }
 
 VkResult SwapChain::acquireNextImage(uint32_t* imageIndex) {
-    vkWaitForFences(
-        device.device(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+    PROFILE_ZONE("SwapChain::acquireNextImage");
+
+    if (device.isTimelineSemaphoreEnabled()) {
+        device.waitTimelineValue(frameTimelineValues[currentFrame]);
+    }
+    else {
+        vkWaitForFences(
+            device.device(),
+            1,
+            &inFlightFences[currentFrame],
+            VK_TRUE,
+            std::numeric_limits<uint64_t>::max());
+    }
+
+    // Every frame in flight has its own offscreen image, which is free again now that the frame is done
+    if (offscreen) {
+        *imageIndex = static_cast<uint32_t>(currentFrame);
+        return VK_SUCCESS;
+    }
 
     VkResult result = vkAcquireNextImageKHR(
         device.device(),
@@ -83,19 +131,33 @@ VkResult SwapChain::acquireNextImage(uint32_t* imageIndex) {
     return result;
 }
 
+bool SwapChain::isFrameComplete(int frameIndex) const {
+    if (device.isTimelineSemaphoreEnabled()) {
+        return device.getCompletedTimelineValue() >= frameTimelineValues[frameIndex];
+    }
+    return vkGetFenceStatus(device.device(), inFlightFences[frameIndex]) == VK_SUCCESS;
+}
+
 VkResult SwapChain::submitCommandBuffers(
     const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+    bool timeline = device.isTimelineSemaphoreEnabled();
+    if (timeline) {
+        device.waitTimelineValue(imageTimelineValues[*imageIndex]);
+    }
+    else {
+        if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
     }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    // Nothing is acquired or presented offscreen, so there are no semaphores to wait on or signal
     VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = offscreen ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -103,15 +165,31 @@ VkResult SwapChain::submitCommandBuffers(
     submitInfo.pCommandBuffers = buffers;
 
     VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = offscreen ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS) {
+    // The timeline value signaled by the submit replaces the fence, so there is nothing to reset
+    VkFence fence = VK_NULL_HANDLE;
+    if (!timeline) {
+        fence = inFlightFences[currentFrame];
+        vkResetFences(device.device(), 1, &fence);
+    }
+
+    uint64_t signaledValue = 0;
+    if (device.submitToGraphicsQueue(submitInfo, fence, &signaledValue) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (timeline) {
+        frameTimelineValues[currentFrame] = signaledValue;
+        imageTimelineValues[*imageIndex] = signaledValue;
+    }
+
+    if (offscreen) {
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        return VK_SUCCESS;
+    }
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -124,9 +202,13 @@ VkResult SwapChain::submitCommandBuffers(
 
     presentInfo.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    VkResult result;
+    {
+        PROFILE_ZONE("vkQueuePresentKHR");
+        result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
 
     return result;
 }
@@ -138,7 +220,8 @@ void SwapChain::createSwapChain() {
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    // Every frame in flight needs an image to render to, otherwise acquiring the next image blocks anyway
+    uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, static_cast<uint32_t>(framesInFlight));
     if (swapChainSupport.capabilities.maxImageCount > 0 &&
         imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -193,6 +276,46 @@ void SwapChain::createSwapChain() {
     swapChainExtent = extent;
 }
 
+void SwapChain::createOffscreenImages() {
+    swapChainImageFormat = device.findSupportedFormat(
+        { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+    swapChainExtent = windowExtent;
+
+    swapChainImages.resize(framesInFlight);
+    offscreenImageMemorys.resize(framesInFlight);
+
+    for (int i = 0; i < framesInFlight; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // Can be copied out to look at (or compare) the rendered frame
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+
+        device.createImageWithInfo(
+            imageInfo,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            swapChainImages[i],
+            offscreenImageMemorys[i]);
+    }
+}
+
+VkImageLayout SwapChain::getColorImageLayout() const {
+    return offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
 void SwapChain::createImageViews() {
     swapChainImageViews.resize(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -214,41 +337,61 @@ void SwapChain::createImageViews() {
     }
 }
 
-void SwapChain::createRenderPass() {
+void SwapChain::createRenderPasses() {
+    renderPass = createRenderPass(false, false);
+    loadRenderPass = createRenderPass(true, false);
+    depthPrepassRenderPass = createRenderPass(false, true);
+}
+
+VkRenderPass SwapChain::createRenderPass(bool loadContents, bool depthPrepass) {
+    // The depth is stored so it can be read after the render pass (for example to build a depth pyramid)
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.loadOp = loadContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = loadContents ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
     depthAttachmentRef.attachment = 1;
     depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+    // A render pass that continues on the image of an earlier one picks it up in the layout that one left it in
     VkAttachmentDescription colorAttachment = {};
     colorAttachment.format = getSwapChainImageFormat();
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.loadOp = loadContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.initialLayout = loadContents ? getColorImageLayout() : VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = getColorImageLayout();
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    // The depth pre-pass subpass only writes the depth, the subpass after it draws the color against that depth
+    VkSubpassDescription depthSubpass = {};
+    depthSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    depthSubpass.colorAttachmentCount = 0;
+    depthSubpass.pDepthStencilAttachment = &depthAttachmentRef;
+
     VkSubpassDescription subpass = {};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+    std::vector<VkSubpassDescription> subpasses;
+    if (depthPrepass) {
+        subpasses.push_back(depthSubpass);
+    }
+    subpasses.push_back(subpass);
+
     VkSubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.srcAccessMask = 0;
@@ -257,23 +400,52 @@ void SwapChain::createRenderPass() {
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+    if (loadContents) {
+        // The color written by the earlier render pass has to be visible before it gets loaded (the depth is
+        // handed over by whoever used it in between)
+        dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    }
+
+    std::vector<VkSubpassDependency> dependencies{ dependency };
+    if (depthPrepass) {
+        // The depth tests of the color subpass read the depth written by the pre-pass
+        VkSubpassDependency depthDependency = {};
+        depthDependency.srcSubpass = 0;
+        depthDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthDependency.dstSubpass = 1;
+        depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        depthDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        dependencies.push_back(depthDependency);
+    }
+
     std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
 
-    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    VkRenderPass createdRenderPass;
+    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &createdRenderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+
+    return createdRenderPass;
 }
 
 void SwapChain::createFramebuffers() {
+    // The depth pre-pass render pass has a different subpass layout, so it is not compatible with the framebuffers
+    // of the other render passes and gets its own
     swapChainFramebuffers.resize(imageCount());
+    depthPrepassFramebuffers.resize(imageCount());
     for (size_t i = 0; i < imageCount(); i++) {
         std::array<VkImageView, 2> attachments = { swapChainImageViews[i], depthImageViews[i] };
 
@@ -294,6 +466,15 @@ void SwapChain::createFramebuffers() {
             &swapChainFramebuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create framebuffer!");
         }
+
+        framebufferInfo.renderPass = depthPrepassRenderPass;
+        if (vkCreateFramebuffer(
+            device.device(),
+            &framebufferInfo,
+            nullptr,
+            &depthPrepassFramebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
     }
 }
 
@@ -318,7 +499,7 @@ void SwapChain::createDepthResources() {
         imageInfo.format = depthFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.flags = 0;
@@ -347,10 +528,15 @@ void SwapChain::createDepthResources() {
 }
 
 void SwapChain::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(framesInFlight);
+    renderFinishedSemaphores.resize(framesInFlight);
+    bool createFences = inFlightFences.empty() && !device.isTimelineSemaphoreEnabled();
+    if (createFences) {
+        inFlightFences.resize(framesInFlight);
+    }
     imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    frameTimelineValues.resize(framesInFlight, 0);
+    imageTimelineValues.resize(imageCount(), 0);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -359,12 +545,12 @@ void SwapChain::createSyncObjects() {
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (int i = 0; i < framesInFlight; i++) {
         if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
             vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
             VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            (createFences && vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
@@ -423,5 +609,5 @@ VkFormat SwapChain::findDepthFormat() {
     return device.findSupportedFormat(
         { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-}
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+}
\ No newline at end of file
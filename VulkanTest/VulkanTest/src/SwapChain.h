@@ -12,9 +12,15 @@
 
 class SwapChain {
 public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-    SwapChain(Device& deviceRef, VkExtent2D windowExtent);
+    // The amount of frames in flight is picked at startup, fewer frames give less latency between input and
+    // the frame on screen, more frames absorb uneven CPU and GPU frame times
+    static constexpr int MIN_FRAMES_IN_FLIGHT = 1;
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+    static constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+    SwapChain(Device& deviceRef, VkExtent2D windowExtent, int framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+    // Keeps the amount of frames in flight (and the current frame index) of the previous swap chain and takes over
+    // its frame fences (or timeline values). The previous swap chain may only be destroyed once the frames submitted to it are done
     SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
     ~SwapChain();
 
@@ -23,8 +29,18 @@ public:
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() { return renderPass; }
+    // Compatible with getRenderPass, but keeps the color and depth of an earlier render pass in the same frame
+    VkRenderPass getLoadRenderPass() { return loadRenderPass; }
+    // Clears like getRenderPass, but starts with a depth only subpass before the subpass that draws the color
+    VkRenderPass getDepthPrepassRenderPass() { return depthPrepassRenderPass; }
+    VkFramebuffer getDepthPrepassFrameBuffer(int index) { return depthPrepassFramebuffers[index]; }
+    VkImage getImage(int index) { return swapChainImages[index]; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+    VkImage getDepthImage(int index) { return depthImages[index]; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+    VkFormat getDepthFormat() { return swapChainDepthFormat; }
     size_t imageCount() { return swapChainImages.size(); }
+    int getFramesInFlight() const { return framesInFlight; }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
@@ -36,8 +52,18 @@ public:
     VkFormat findDepthFormat();
 
     VkResult acquireNextImage(uint32_t* imageIndex);
+    // Whether the last frame submitted with this frame index has finished on the GPU, without waiting for it
+    bool isFrameComplete(int frameIndex) const;
+    // With the device's timeline semaphore, the value the last frame submitted with this frame index signals
+    uint64_t getFrameTimelineValue(int frameIndex) const { return frameTimelineValues[frameIndex]; }
     VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
+    // Headless, the images are offscreen color images (one per frame in flight) that are left in the transfer source
+    // layout after every render pass, instead of being presented
+    bool isOffscreen() const { return offscreen; }
+    // Layout the color images are in after a render pass
+    VkImageLayout getColorImageLayout() const;
+
     bool compareSwapFormats(const SwapChain& swapChain) const
     {
         return swapChain.swapChainDepthFormat == swapChainDepthFormat && 
@@ -47,9 +73,11 @@ public:
 private:
     void init();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createDepthResources();
-    void createRenderPass();
+    void createRenderPasses();
+    VkRenderPass createRenderPass(bool loadContents, bool depthPrepass);
     void createFramebuffers();
     void createSyncObjects();
 
@@ -66,6 +94,9 @@ private:
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
+    VkRenderPass loadRenderPass;
+    VkRenderPass depthPrepassRenderPass;
+    std::vector<VkFramebuffer> depthPrepassFramebuffers;
 
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
@@ -76,12 +107,18 @@ private:
     Device& device;
     VkExtent2D windowExtent;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::shared_ptr<SwapChain> oldSwapChain;
+    bool offscreen;
+    std::vector<VkDeviceMemory> offscreenImageMemorys;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
+    // Used instead of the fences when the device has a timeline semaphore, 0 when nothing was submitted yet
+    std::vector<uint64_t> frameTimelineValues;
+    std::vector<uint64_t> imageTimelineValues;
+    int framesInFlight;
     size_t currentFrame = 0;
-};
+};
\ No newline at end of file
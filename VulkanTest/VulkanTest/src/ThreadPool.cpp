@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+
+	m_threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_workAvailable.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::parallelFor(uint32_t taskCount, const Task& task)
+{
+	if (taskCount == 0)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	assert(m_task == nullptr && "Cannot start a parallelFor while another one is still running");
+
+	m_task = &task;
+	m_taskCount = taskCount;
+	m_nextTask = 0;
+	m_finishedTasks = 0;
+	m_exception = nullptr;
+
+	m_workAvailable.notify_all();
+	m_workFinished.wait(lock, [this] { return m_finishedTasks == m_taskCount; });
+
+	m_task = nullptr;
+	m_taskCount = 0;
+	m_nextTask = 0;
+
+	if (m_exception)
+	{
+		std::rethrow_exception(m_exception);
+	}
+}
+
+void ThreadPool::workerLoop(uint32_t threadIndex)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_workAvailable.wait(lock, [this] { return m_stopping || m_nextTask < m_taskCount; });
+
+		if (m_stopping)
+		{
+			return;
+		}
+
+		// Tasks are expected to be coarse (a chunk of work per thread), so claiming them under the lock is cheap
+		uint32_t taskIndex = m_nextTask++;
+		lock.unlock();
+
+		try
+		{
+			(*m_task)(taskIndex, threadIndex);
+		}
+		catch (...)
+		{
+			lock.lock();
+			if (!m_exception)
+			{
+				m_exception = std::current_exception();
+			}
+			lock.unlock();
+		}
+
+		lock.lock();
+		if (++m_finishedTasks == m_taskCount)
+		{
+			m_workFinished.notify_one();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	using Task = std::function<void(uint32_t taskIndex, uint32_t threadIndex)>;
+
+private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workFinished;
+
+	const Task* m_task = nullptr;
+	uint32_t m_taskCount = 0;
+	uint32_t m_nextTask = 0;
+	uint32_t m_finishedTasks = 0;
+	std::exception_ptr m_exception;
+	bool m_stopping = false;
+
+public:
+	ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+	// Runs the task once for every task index in [0, taskCount) on the worker threads and blocks until all of them
+	// are finished. The thread index passed to the task is stable per worker, so it can be used to pick per-thread
+	// resources (a worker only ever runs one task at a time)
+	void parallelFor(uint32_t taskCount, const Task& task);
+
+private:
+	void workerLoop(uint32_t threadIndex);
+};
\ No newline at end of file
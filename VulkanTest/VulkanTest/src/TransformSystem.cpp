@@ -0,0 +1,745 @@
+#include "TransformSystem.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+glm::mat4 TransformComponent::getTransformationMatrix()
+{
+	// Rotation convention uses Tait-bryan angles with axis order Y, X, Z
+
+	// Intrinsic rotation (coordinate system moves with rotation, local rotation)
+	const float c3 = glm::cos(rotation.y);
+	const float s3 = glm::sin(rotation.y);
+	const float c2 = glm::cos(rotation.x);
+	const float s2 = glm::sin(rotation.x);
+	const float c1 = glm::cos(rotation.z);
+	const float s1 = glm::sin(rotation.z);
+
+	// Extrinsic rotation (coordinate system stays fixed, global rotation)
+	//const float c3 = glm::cos(rotation.z);
+	//const float s3 = glm::sin(rotation.z);
+	//const float c2 = glm::cos(rotation.x);
+	//const float s2 = glm::sin(rotation.x);
+	//const float c1 = glm::cos(rotation.y);
+	//const float s1 = glm::sin(rotation.y);
+
+	return glm::mat4
+	{
+		{
+			scale.x * (c1 * c3 + s1 * s2 * s3),
+			scale.x * (c2 * s3),
+			scale.x * (c1 * s2 * s3 - c3 * s1),
+			0.0f,
+		},
+		{
+			scale.y * (c3 * s1 * s2 - c1 * s3),
+			scale.y * (c2 * c3),
+			scale.y * (c1 * c3 * s2 + s1 * s3),
+			0.0f,
+		},
+		{
+			scale.z * (c2 * s1),
+			scale.z * (-s2),
+			scale.z * (c1 * c2),
+			0.0f,
+		},
+		{translation.x, translation.y, translation.z, 1.0f}
+	};
+}
+
+glm::mat3 TransformComponent::getNormalMatrix()
+{
+	// Rotation convention uses Tait-bryan angles with axis order Y, X, Z
+
+	// Intrinsic rotation (coordinate system moves with rotation, local rotation)
+	const float c3 = glm::cos(rotation.y);
+	const float s3 = glm::sin(rotation.y);
+	const float c2 = glm::cos(rotation.x);
+	const float s2 = glm::sin(rotation.x);
+	const float c1 = glm::cos(rotation.z);
+	const float s1 = glm::sin(rotation.z);
+
+	// Extrinsic rotation (coordinate system stays fixed, global rotation)
+	//const float c3 = glm::cos(rotation.z);
+	//const float s3 = glm::sin(rotation.z);
+	//const float c2 = glm::cos(rotation.x);
+	//const float s2 = glm::sin(rotation.x);
+	//const float c1 = glm::cos(rotation.y);
+	//const float s1 = glm::sin(rotation.y);
+
+	const glm::vec3 inverseScale = 1.0f / scale;
+
+	return glm::mat3
+	{
+		{
+			inverseScale.x * (c1 * c3 + s1 * s2 * s3),
+			inverseScale.x * (c2 * s3),
+			inverseScale.x * (c1 * s2 * s3 - c3 * s1)
+		},
+		{
+			inverseScale.y * (c3 * s1 * s2 - c1 * s3),
+			inverseScale.y * (c2 * c3),
+			inverseScale.y * (c1 * c3 * s2 + s1 * s3)
+		},
+		{
+			inverseScale.z * (c2 * s1),
+			inverseScale.z * (-s2),
+			inverseScale.z * (c1 * c2)
+		}
+	};
+}
+
+TransformSystem::id_t TransformSystem::createTransform(const TransformComponent& transform)
+{
+	id_t id;
+	if (!m_freeIds.empty())
+	{
+		id = m_freeIds.back();
+		m_freeIds.pop_back();
+
+		m_translationX[id] = transform.translation.x;
+		m_translationY[id] = transform.translation.y;
+		m_translationZ[id] = transform.translation.z;
+		m_rotationX[id] = transform.rotation.x;
+		m_rotationY[id] = transform.rotation.y;
+		m_rotationZ[id] = transform.rotation.z;
+		m_scaleX[id] = transform.scale.x;
+		m_scaleY[id] = transform.scale.y;
+		m_scaleZ[id] = transform.scale.z;
+
+		// The slot at the end no longer matches the id
+		m_slotsMatchIds = false;
+	}
+	else
+	{
+		id = static_cast<id_t>(m_translationX.size());
+
+		m_translationX.push_back(transform.translation.x);
+		m_translationY.push_back(transform.translation.y);
+		m_translationZ.push_back(transform.translation.z);
+		m_rotationX.push_back(transform.rotation.x);
+		m_rotationY.push_back(transform.rotation.y);
+		m_rotationZ.push_back(transform.rotation.z);
+		m_scaleX.push_back(transform.scale.x);
+		m_scaleY.push_back(transform.scale.y);
+		m_scaleZ.push_back(transform.scale.z);
+
+		m_localModelMatrices.emplace_back(1.0f);
+		m_localNormalMatrices.emplace_back(1.0f);
+
+		m_parents.push_back(INVALID_ID);
+		m_children.emplace_back();
+		m_slots.push_back(INVALID_ID);
+
+		m_versions.push_back(0);
+		m_dirty.push_back(false);
+	}
+
+	// Appended as a root, which keeps the depth-first order valid
+	m_slots[id] = static_cast<uint32_t>(m_order.size());
+	m_order.push_back(id);
+	m_parentSlots.push_back(INVALID_ID);
+	m_subtreeSizes.push_back(1);
+	m_worldModelMatrices.emplace_back(1.0f);
+	m_worldNormalMatrices.emplace_back(1.0f);
+
+	markDirty(id);
+
+	return id;
+}
+
+void TransformSystem::destroyTransform(id_t id)
+{
+	assert(isAlive(id) && "Transform was already destroyed");
+
+	setParent(id, INVALID_ID);
+
+	// Children keep their local transform, which from now on is relative to the world
+	for (id_t child : m_children[id])
+	{
+		m_parents[child] = INVALID_ID;
+	}
+
+	m_children[id].clear();
+
+	// Left out of the order from the next update on, the id gets reused by the next created transform
+	m_slots[id] = INVALID_ID;
+	m_freeIds.push_back(id);
+	m_hierarchyChanged = true;
+}
+
+void TransformSystem::setTranslation(id_t id, const glm::vec3& translation)
+{
+	if (getTranslation(id) == translation)
+	{
+		return;
+	}
+
+	m_translationX[id] = translation.x;
+	m_translationY[id] = translation.y;
+	m_translationZ[id] = translation.z;
+	markDirty(id);
+}
+
+void TransformSystem::setRotation(id_t id, const glm::vec3& rotation)
+{
+	if (getRotation(id) == rotation)
+	{
+		return;
+	}
+
+	m_rotationX[id] = rotation.x;
+	m_rotationY[id] = rotation.y;
+	m_rotationZ[id] = rotation.z;
+	markDirty(id);
+}
+
+void TransformSystem::setScale(id_t id, const glm::vec3& scale)
+{
+	if (getScale(id) == scale)
+	{
+		return;
+	}
+
+	m_scaleX[id] = scale.x;
+	m_scaleY[id] = scale.y;
+	m_scaleZ[id] = scale.z;
+	markDirty(id);
+}
+
+void TransformSystem::setParent(id_t id, id_t parent)
+{
+	if (m_parents[id] == parent)
+	{
+		return;
+	}
+
+	for (id_t ancestor = parent; ancestor != INVALID_ID; ancestor = m_parents[ancestor])
+	{
+		assert(ancestor != id && "Cannot parent a transform to itself or one of its descendants");
+	}
+
+	if (m_parents[id] != INVALID_ID)
+	{
+		auto& siblings = m_children[m_parents[id]];
+		siblings.erase(std::find(siblings.begin(), siblings.end(), id));
+	}
+
+	if (parent != INVALID_ID)
+	{
+		m_children[parent].push_back(id);
+	}
+
+	m_parents[id] = parent;
+	m_hierarchyChanged = true;
+}
+
+void TransformSystem::markDirty(id_t id)
+{
+	if (!m_dirty[id])
+	{
+		m_dirty[id] = true;
+		m_dirtyIds.push_back(id);
+	}
+}
+
+void TransformSystem::update()
+{
+	PROFILE_ZONE("TransformSystem::update");
+
+	m_changedIds.clear();
+
+	if (m_dirtyIds.empty() && !m_hierarchyChanged)
+	{
+		return;
+	}
+
+	bool rootsInLocal = true;
+	if (m_hierarchyChanged)
+	{
+		// World matrices are stored by slot, so all of them get recomputed after the order changed
+		rebuildHierarchy();
+		m_hierarchyChanged = false;
+
+		ComputeMatrices(getArrays(), size(), m_localModelMatrices.data(), m_localNormalMatrices.data());
+
+		m_dirtyRanges.clear();
+		for (uint32_t root = 0; root < m_order.size(); root += m_subtreeSizes[root])
+		{
+			m_dirtyRanges.push_back(SlotRange{ root, m_subtreeSizes[root] });
+		}
+	}
+	else
+	{
+		findDirtyRanges();
+		rootsInLocal = updateLocalMatrices();
+	}
+
+	uint32_t dirtyTransformCount = 0;
+	for (const SlotRange& range : m_dirtyRanges)
+	{
+		dirtyTransformCount += range.count;
+	}
+
+	uint32_t taskCount = 1;
+	if (m_threadPool != nullptr)
+	{
+		taskCount = std::min(m_threadPool->getThreadCount(), dirtyTransformCount / MIN_TRANSFORMS_PER_PROPAGATION_TASK);
+		taskCount = std::min(taskCount, static_cast<uint32_t>(m_dirtyRanges.size()));
+	}
+
+	if (taskCount <= 1)
+	{
+		for (const SlotRange& range : m_dirtyRanges)
+		{
+			propagateRange(range, rootsInLocal);
+		}
+	}
+	else
+	{
+		// Ranges don't share any transforms, so every task gets its own run of ranges with about the same amount of
+		// transforms in them
+		std::vector<uint32_t> taskStarts(taskCount + 1, static_cast<uint32_t>(m_dirtyRanges.size()));
+		uint32_t transformsPerTask = (dirtyTransformCount + taskCount - 1) / taskCount;
+		uint32_t transformCount = 0;
+		uint32_t task = 0;
+		for (uint32_t i = 0; i < m_dirtyRanges.size() && task < taskCount; i++)
+		{
+			if (transformCount >= task * transformsPerTask)
+			{
+				taskStarts[task++] = i;
+			}
+
+			transformCount += m_dirtyRanges[i].count;
+		}
+
+		m_threadPool->parallelFor(taskCount, [&](uint32_t taskIndex, uint32_t)
+		{
+			for (uint32_t i = taskStarts[taskIndex]; i < taskStarts[taskIndex + 1]; i++)
+			{
+				propagateRange(m_dirtyRanges[i], rootsInLocal);
+			}
+		});
+	}
+
+	// Exactly the transforms in the ranges changed, in slot order
+	m_changedIds.reserve(dirtyTransformCount);
+	for (const SlotRange& range : m_dirtyRanges)
+	{
+		m_changedIds.insert(m_changedIds.end(), m_order.begin() + range.firstSlot, m_order.begin() + range.firstSlot + range.count);
+	}
+
+	if (m_dirtyIds.size() * DIRTY_SCAN_RATIO >= size())
+	{
+		std::fill(m_dirty.begin(), m_dirty.end(), false);
+	}
+	else
+	{
+		for (id_t id : m_dirtyIds)
+		{
+			m_dirty[id] = false;
+		}
+	}
+
+	m_dirtyIds.clear();
+}
+
+// Returns whether the matrices of roots ended up in the local matrices and still have to be copied
+bool TransformSystem::updateLocalMatrices()
+{
+	if (m_dirtyIds.empty())
+	{
+		return false;
+	}
+
+	// When most transforms changed anyway, one pass over all of them beats gathering the dirty ones
+	if (m_dirtyIds.size() * 2 < size())
+	{
+		updateDirtyLocalMatrices();
+		return false;
+	}
+
+	// Every transform is a root in the slot of its id, so the kernel can write the world matrices directly
+	if (m_slotsMatchIds)
+	{
+		ComputeMatrices(getArrays(), size(), m_worldModelMatrices.data(), m_worldNormalMatrices.data());
+		return false;
+	}
+
+	ComputeMatrices(getArrays(), size(), m_localModelMatrices.data(), m_localNormalMatrices.data());
+	return true;
+}
+
+void TransformSystem::rebuildHierarchy()
+{
+	// Destroyed transforms get left out, so there is one slot for every transform that is alive
+	const size_t slotCount = size() - m_freeIds.size();
+	m_order.resize(slotCount);
+	m_parentSlots.resize(slotCount);
+	m_subtreeSizes.resize(slotCount);
+	m_worldModelMatrices.resize(slotCount);
+	m_worldNormalMatrices.resize(slotCount);
+
+	uint32_t slot = 0;
+	bool hasParents = false;
+	for (id_t root = 0; root < size(); root++)
+	{
+		if (m_parents[root] != INVALID_ID || !isAlive(root))
+		{
+			continue;
+		}
+
+		// Children are pushed in reverse, so they get their slots in the order they were added
+		m_rebuildStack.push_back(root);
+		while (!m_rebuildStack.empty())
+		{
+			id_t id = m_rebuildStack.back();
+			m_rebuildStack.pop_back();
+
+			m_order[slot] = id;
+			m_slots[id] = slot;
+			m_parentSlots[slot] = m_parents[id] != INVALID_ID ? m_slots[m_parents[id]] : INVALID_ID;
+			hasParents |= m_parents[id] != INVALID_ID;
+			slot++;
+
+			m_rebuildStack.insert(m_rebuildStack.end(), m_children[id].rbegin(), m_children[id].rend());
+		}
+	}
+
+	assert(slot == slotCount && "Every transform has to be reachable from a root");
+
+	// Without parents the depth-first order is the order of the ids, unless some of them are missing
+	m_slotsMatchIds = !hasParents && m_freeIds.empty();
+
+	// Children come after their parent, so walking backwards every subtree is complete before it's added to its parent
+	std::fill(m_subtreeSizes.begin(), m_subtreeSizes.end(), 1);
+	for (uint32_t i = slot; i-- > 0;)
+	{
+		if (m_parentSlots[i] != INVALID_ID)
+		{
+			m_subtreeSizes[m_parentSlots[i]] += m_subtreeSizes[i];
+		}
+	}
+}
+
+void TransformSystem::findDirtyRanges()
+{
+	m_dirtyRanges.clear();
+
+	// With many dirty transforms one pass over the order is cheaper than sorting their slots. In both cases a dirty
+	// transform inside the range of an earlier one is already covered by it
+	if (m_dirtyIds.size() * DIRTY_SCAN_RATIO >= size())
+	{
+		for (uint32_t slot = 0; slot < m_order.size();)
+		{
+			if (m_dirty[m_order[slot]])
+			{
+				addDirtyRange(slot);
+				slot += m_subtreeSizes[slot];
+			}
+			else
+			{
+				slot++;
+			}
+		}
+
+		return;
+	}
+
+	m_dirtySlots.clear();
+	for (id_t id : m_dirtyIds)
+	{
+		m_dirtySlots.push_back(m_slots[id]);
+	}
+
+	std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+	uint32_t coveredEnd = 0;
+	for (uint32_t slot : m_dirtySlots)
+	{
+		if (slot < coveredEnd)
+		{
+			continue;
+		}
+
+		addDirtyRange(slot);
+		coveredEnd = slot + m_subtreeSizes[slot];
+	}
+}
+
+void TransformSystem::addDirtyRange(uint32_t slot)
+{
+	// Neighbouring ranges are merged so runs of dirty transforms are propagated and reported in one go
+	if (!m_dirtyRanges.empty() && m_dirtyRanges.back().firstSlot + m_dirtyRanges.back().count == slot)
+	{
+		m_dirtyRanges.back().count += m_subtreeSizes[slot];
+	}
+	else
+	{
+		m_dirtyRanges.push_back(SlotRange{ slot, m_subtreeSizes[slot] });
+	}
+}
+
+void TransformSystem::propagateRange(const SlotRange& range, bool rootsInLocal)
+{
+	// Parents come before their children, and the parent of the first slot is outside of every dirty range, so a
+	// parent's world matrices are always up to date here. The normal matrix of a product is the product of the normal
+	// matrices, so it can be propagated the same way
+	for (uint32_t slot = range.firstSlot; slot < range.firstSlot + range.count; slot++)
+	{
+		id_t id = m_order[slot];
+		uint32_t parentSlot = m_parentSlots[slot];
+
+		if (parentSlot == INVALID_ID)
+		{
+			if (rootsInLocal)
+			{
+				m_worldModelMatrices[slot] = m_localModelMatrices[id];
+				m_worldNormalMatrices[slot] = m_localNormalMatrices[id];
+			}
+		}
+		else
+		{
+			m_worldModelMatrices[slot] = m_worldModelMatrices[parentSlot] * m_localModelMatrices[id];
+			m_worldNormalMatrices[slot] = m_worldNormalMatrices[parentSlot] * m_localNormalMatrices[id];
+		}
+
+		m_versions[id]++;
+	}
+}
+
+void TransformSystem::updateDirtyLocalMatrices()
+{
+	// Sorted so the gather and scatter below walk through memory in one direction
+	std::sort(m_dirtyIds.begin(), m_dirtyIds.end());
+
+	const size_t count = m_dirtyIds.size();
+	m_gatherComponents.resize(count * 9);
+	m_gatherModelMatrices.resize(count);
+	m_gatherNormalMatrices.resize(count);
+
+	float* components = m_gatherComponents.data();
+	const std::vector<float>* sources[] =
+	{
+		&m_translationX, &m_translationY, &m_translationZ,
+		&m_rotationX, &m_rotationY, &m_rotationZ,
+		&m_scaleX, &m_scaleY, &m_scaleZ
+	};
+
+	for (size_t component = 0; component < 9; component++)
+	{
+		const std::vector<float>& source = *sources[component];
+		float* destination = components + component * count;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[i] = source[m_dirtyIds[i]];
+		}
+	}
+
+	TransformArrays gathered
+	{
+		components, components + count, components + count * 2,
+		components + count * 3, components + count * 4, components + count * 5,
+		components + count * 6, components + count * 7, components + count * 8
+	};
+
+	ComputeMatrices(gathered, count, m_gatherModelMatrices.data(), m_gatherNormalMatrices.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		id_t id = m_dirtyIds[i];
+		if (m_parents[id] == INVALID_ID)
+		{
+			m_worldModelMatrices[m_slots[id]] = m_gatherModelMatrices[i];
+			m_worldNormalMatrices[m_slots[id]] = m_gatherNormalMatrices[i];
+		}
+		else
+		{
+			m_localModelMatrices[id] = m_gatherModelMatrices[i];
+			m_localNormalMatrices[id] = m_gatherNormalMatrices[i];
+		}
+	}
+}
+
+TransformSystem::TransformArrays TransformSystem::getArrays() const
+{
+	return TransformArrays
+	{
+		m_translationX.data(),
+		m_translationY.data(),
+		m_translationZ.data(),
+		m_rotationX.data(),
+		m_rotationY.data(),
+		m_rotationZ.data(),
+		m_scaleX.data(),
+		m_scaleY.data(),
+		m_scaleZ.data()
+	};
+}
+
+void TransformSystem::ComputeMatricesScalar(const TransformArrays& transforms, size_t count, glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+{
+	// Same rotation convention as TransformComponent (Tait-bryan angles with axis order Y, X, Z), 
+	// but the rotation terms are shared between the model and the normal matrix
+	for (size_t i = 0; i < count; i++)
+	{
+		const float c3 = std::cos(transforms.rotationY[i]);
+		const float s3 = std::sin(transforms.rotationY[i]);
+		const float c2 = std::cos(transforms.rotationX[i]);
+		const float s2 = std::sin(transforms.rotationX[i]);
+		const float c1 = std::cos(transforms.rotationZ[i]);
+		const float s1 = std::sin(transforms.rotationZ[i]);
+
+		const glm::vec3 right{ c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1 };
+		const glm::vec3 up{ c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3 };
+		const glm::vec3 forward{ c2 * s1, -s2, c1 * c2 };
+
+		const glm::vec3 scale{ transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i] };
+		const glm::vec3 inverseScale = 1.0f / scale;
+
+		modelMatrices[i] = glm::mat4
+		{
+			glm::vec4(scale.x * right, 0.0f),
+			glm::vec4(scale.y * up, 0.0f),
+			glm::vec4(scale.z * forward, 0.0f),
+			glm::vec4(transforms.translationX[i], transforms.translationY[i], transforms.translationZ[i], 1.0f)
+		};
+
+		normalMatrices[i] = glm::mat4
+		{
+			glm::vec4(inverseScale.x * right, 0.0f),
+			glm::vec4(inverseScale.y * up, 0.0f),
+			glm::vec4(inverseScale.z * forward, 0.0f),
+			glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
+		};
+	}
+}
+
+#if SIMD_SSE2
+
+// Computes the sine and cosine of 4 angles at once, with the range reduction and minimax polynomials of the 
+// Cephes library (accurate to a couple of ulp for the angle ranges used by transforms)
+static inline void SinCos4(__m128 x, __m128& sin, __m128& cos)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	__m128 sinSign = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	// Octant of the angle, rounded up to an even octant so x is reduced to [-pi/4, pi/4]
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+	octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(octant);
+
+	__m128 sinSwapSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+	__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+	sinSign = _mm_xor_ps(sinSign, sinSwapSign);
+
+	// Extended precision modular arithmetic: x - y * pi/4
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+	__m128 z = _mm_mul_ps(x, x);
+
+	__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+	cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+	cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+	__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+	sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+	// Depending on the octant the polynomials swap roles
+	sin = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+	cos = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+
+	sin = _mm_xor_ps(sin, sinSign);
+	cos = _mm_xor_ps(cos, cosSign);
+}
+
+// Transposes the 3 (or 4) component vectors of 4 objects (one object per lane) and stores them as matrix column
+static inline void StoreColumns(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4* matrices, int column)
+{
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(&matrices[0][column][0], x);
+	_mm_storeu_ps(&matrices[1][column][0], y);
+	_mm_storeu_ps(&matrices[2][column][0], z);
+	_mm_storeu_ps(&matrices[3][column][0], w);
+}
+
+void TransformSystem::ComputeMatrices(const TransformArrays& transforms, size_t count, glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 s3, c3, s2, c2, s1, c1;
+		SinCos4(_mm_loadu_ps(transforms.rotationY + i), s3, c3);
+		SinCos4(_mm_loadu_ps(transforms.rotationX + i), s2, c2);
+		SinCos4(_mm_loadu_ps(transforms.rotationZ + i), s1, c1);
+
+		const __m128 s1s2 = _mm_mul_ps(s1, s2);
+		const __m128 c1s2 = _mm_mul_ps(c1, s2);
+
+		const __m128 rightX = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+		const __m128 rightY = _mm_mul_ps(c2, s3);
+		const __m128 rightZ = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+		const __m128 upX = _mm_sub_ps(_mm_mul_ps(s1s2, c3), _mm_mul_ps(c1, s3));
+		const __m128 upY = _mm_mul_ps(c2, c3);
+		const __m128 upZ = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+		const __m128 forwardX = _mm_mul_ps(c2, s1);
+		const __m128 forwardY = _mm_sub_ps(zero, s2);
+		const __m128 forwardZ = _mm_mul_ps(c1, c2);
+
+		const __m128 scaleX = _mm_loadu_ps(transforms.scaleX + i);
+		const __m128 scaleY = _mm_loadu_ps(transforms.scaleY + i);
+		const __m128 scaleZ = _mm_loadu_ps(transforms.scaleZ + i);
+		const __m128 inverseScaleX = _mm_div_ps(one, scaleX);
+		const __m128 inverseScaleY = _mm_div_ps(one, scaleY);
+		const __m128 inverseScaleZ = _mm_div_ps(one, scaleZ);
+
+		glm::mat4* model = modelMatrices + i;
+		StoreColumns(_mm_mul_ps(scaleX, rightX), _mm_mul_ps(scaleX, rightY), _mm_mul_ps(scaleX, rightZ), zero, model, 0);
+		StoreColumns(_mm_mul_ps(scaleY, upX), _mm_mul_ps(scaleY, upY), _mm_mul_ps(scaleY, upZ), zero, model, 1);
+		StoreColumns(_mm_mul_ps(scaleZ, forwardX), _mm_mul_ps(scaleZ, forwardY), _mm_mul_ps(scaleZ, forwardZ), zero, model, 2);
+		StoreColumns(_mm_loadu_ps(transforms.translationX + i), _mm_loadu_ps(transforms.translationY + i), _mm_loadu_ps(transforms.translationZ + i), one, model, 3);
+
+		glm::mat4* normal = normalMatrices + i;
+		StoreColumns(_mm_mul_ps(inverseScaleX, rightX), _mm_mul_ps(inverseScaleX, rightY), _mm_mul_ps(inverseScaleX, rightZ), zero, normal, 0);
+		StoreColumns(_mm_mul_ps(inverseScaleY, upX), _mm_mul_ps(inverseScaleY, upY), _mm_mul_ps(inverseScaleY, upZ), zero, normal, 1);
+		StoreColumns(_mm_mul_ps(inverseScaleZ, forwardX), _mm_mul_ps(inverseScaleZ, forwardY), _mm_mul_ps(inverseScaleZ, forwardZ), zero, normal, 2);
+		StoreColumns(zero, zero, zero, one, normal, 3);
+	}
+
+	// Remaining objects that don't fill a whole SIMD register
+	TransformArrays remaining
+	{
+		transforms.translationX + i, transforms.translationY + i, transforms.translationZ + i,
+		transforms.rotationX + i, transforms.rotationY + i, transforms.rotationZ + i,
+		transforms.scaleX + i, transforms.scaleY + i, transforms.scaleZ + i
+	};
+
+	ComputeMatricesScalar(remaining, count - i, modelMatrices + i, normalMatrices + i);
+}
+
+#else
+
+void TransformSystem::ComputeMatrices(const TransformArrays& transforms, size_t count, glm::mat4* modelMatrices, glm::mat4* normalMatrices)
+{
+	ComputeMatricesScalar(transforms, count, modelMatrices, normalMatrices);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class ThreadPool;
+
+struct TransformComponent
+{
+	glm::vec3 translation{};
+	glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
+	glm::vec3 rotation{};
+
+	glm::mat4 getTransformationMatrix();
+	glm::mat3 getNormalMatrix();
+};
+
+// Stores all transforms as structure-of-arrays and computes the model and normal matrices in one batched pass
+// (every sin/cos is only computed once per object, 4 objects at a time when SSE2 is available). Only transforms
+// that changed since the last update get recomputed, so static objects cost nothing per frame.
+//
+// Transforms can have a parent, in which case their translation, rotation and scale are relative to it. For the
+// world matrices the transforms are kept in depth-first order, so parents always come before their children and the
+// descendants of every transform are stored right after it. Updating the world matrices below a changed transform
+// is then one linear pass over its range of slots, nothing outside of those ranges is touched, and the ranges are
+// independent so they can be updated in parallel
+class TransformSystem
+{
+public:
+	using id_t = uint32_t;
+
+	static constexpr id_t INVALID_ID = std::numeric_limits<id_t>::max();
+
+	// Ranges are only spread over threads when there are enough transforms to update to be worth the overhead
+	static constexpr uint32_t MIN_TRANSFORMS_PER_PROPAGATION_TASK = 1024;
+
+	// Dirty transforms are found by scanning all slots instead of sorting once at least one in this many is dirty
+	static constexpr uint32_t DIRTY_SCAN_RATIO = 16;
+
+	// Views on the component arrays of a batch of transforms
+	struct TransformArrays
+	{
+		const float* translationX;
+		const float* translationY;
+		const float* translationZ;
+		const float* rotationX;
+		const float* rotationY;
+		const float* rotationZ;
+		const float* scaleX;
+		const float* scaleY;
+		const float* scaleZ;
+	};
+
+private:
+	std::vector<float> m_translationX;
+	std::vector<float> m_translationY;
+	std::vector<float> m_translationZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+
+	// Relative to the parent, indexed by id. Only kept up to date for transforms with a parent, the matrices of roots
+	// are written straight into their world matrices
+	std::vector<glm::mat4> m_localModelMatrices;
+	std::vector<glm::mat4> m_localNormalMatrices;
+
+	// Hierarchy, indexed by id
+	std::vector<id_t> m_parents;
+	std::vector<std::vector<id_t>> m_children;
+	std::vector<id_t> m_freeIds;
+
+	// Depth-first order of all transforms, indexed by slot. The subtree size counts the transform itself, so its
+	// descendants are the slots up to slot + subtree size
+	std::vector<id_t> m_order;
+	std::vector<uint32_t> m_parentSlots;
+	std::vector<uint32_t> m_subtreeSizes;
+	std::vector<glm::mat4> m_worldModelMatrices;
+	std::vector<glm::mat4> m_worldNormalMatrices;
+	std::vector<uint32_t> m_slots;
+	std::vector<id_t> m_rebuildStack;
+
+	// Set when no transform has a parent and every transform is in the slot of its id
+	bool m_slotsMatchIds = true;
+
+	// Slots whose world matrices have to be recomputed this update, every changed transform with its descendants
+	struct SlotRange
+	{
+		uint32_t firstSlot;
+		uint32_t count;
+	};
+
+	std::vector<uint32_t> m_dirtySlots;
+	std::vector<SlotRange> m_dirtyRanges;
+	bool m_hierarchyChanged = false;
+
+	ThreadPool* m_threadPool = nullptr;
+
+	// Bumped every time the world matrices change, so systems that cache data derived from a transform can tell
+	// when it is outdated
+	std::vector<uint32_t> m_versions;
+	std::vector<bool> m_dirty;
+	std::vector<id_t> m_dirtyIds;
+	std::vector<id_t> m_changedIds;
+
+	// Dirty transforms get packed into these before running the batched kernel on them
+	std::vector<float> m_gatherComponents;
+	std::vector<glm::mat4> m_gatherModelMatrices;
+	std::vector<glm::mat4> m_gatherNormalMatrices;
+
+public:
+	TransformSystem() = default;
+
+	TransformSystem(const TransformSystem&) = delete;
+	TransformSystem& operator=(const TransformSystem&) = delete;
+
+	// Ids of destroyed transforms get reused. Their children become roots, keeping their local transform
+	id_t createTransform(const TransformComponent& transform = {});
+	void destroyTransform(id_t id);
+	bool isAlive(id_t id) const { return id < m_slots.size() && m_slots[id] != INVALID_ID; }
+
+	glm::vec3 getTranslation(id_t id) const { return { m_translationX[id], m_translationY[id], m_translationZ[id] }; }
+	glm::vec3 getRotation(id_t id) const { return { m_rotationX[id], m_rotationY[id], m_rotationZ[id] }; }
+	glm::vec3 getScale(id_t id) const { return { m_scaleX[id], m_scaleY[id], m_scaleZ[id] }; }
+
+	void setTranslation(id_t id, const glm::vec3& translation);
+	void setRotation(id_t id, const glm::vec3& rotation);
+	void setScale(id_t id, const glm::vec3& scale);
+
+	// The parent has to be a transform that is not a descendant of this one, INVALID_ID makes the transform a root
+	void setParent(id_t id, id_t parent);
+	id_t getParent(id_t id) const { return m_parents[id]; }
+
+	// World matrices, only valid after the last update()
+	const glm::mat4& getModelMatrix(id_t id) const { return m_worldModelMatrices[m_slots[id]]; }
+	const glm::mat4& getNormalMatrix(id_t id) const { return m_worldNormalMatrices[m_slots[id]]; }
+
+	// Only changes when the world matrices do (including when the id gets reused), starting at 0 for a new id
+	uint32_t getVersion(id_t id) const { return m_versions[id]; }
+
+	// Used to update independent subtrees in parallel, can be null
+	void setThreadPool(ThreadPool* threadPool) { m_threadPool = threadPool; }
+
+	// Number of ids in use, including destroyed transforms whose id has not been reused yet
+	size_t size() const { return m_translationX.size(); }
+	size_t getDirtyCount() const { return m_dirtyIds.size(); }
+
+	// Transforms whose world matrices changed in the last update (including the descendants of changed transforms)
+	const std::vector<id_t>& getChangedIds() const { return m_changedIds; }
+
+	// Recomputes the model and normal matrices of the transforms that changed since the last update, together with
+	// the world matrices of all their descendants
+	void update();
+
+	// Batched kernels, writing count model and normal matrices (the normal matrix is stored as a mat4 so it can be
+	// copied to the GPU as is). ComputeMatrices uses SSE2 when available and falls back to ComputeMatricesScalar
+	static void ComputeMatrices(const TransformArrays& transforms, size_t count, glm::mat4* modelMatrices, glm::mat4* normalMatrices);
+	static void ComputeMatricesScalar(const TransformArrays& transforms, size_t count, glm::mat4* modelMatrices, glm::mat4* normalMatrices);
+
+private:
+	TransformArrays getArrays() const;
+
+	void markDirty(id_t id);
+	bool updateLocalMatrices();
+	void updateDirtyLocalMatrices();
+	void rebuildHierarchy();
+	void findDirtyRanges();
+	void addDirtyRange(uint32_t slot);
+	void propagateRange(const SlotRange& range, bool rootsInLocal);
+};
\ No newline at end of file
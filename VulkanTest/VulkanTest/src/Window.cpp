@@ -1,16 +1,23 @@
 #include "Window.h"
 #include <stdexcept>
 
-Window::Window(const std::string& windowName, int width, int height)
+Window::Window(const std::string& windowName, int width, int height, bool headless): m_headless(headless)
 {
+	m_width = width;
+	m_height = height;
+
+	if (m_headless)
+	{
+		m_window = nullptr;
+		return;
+	}
+
 	glfwInit();
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	m_window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
-	m_width = width;
-	m_height = height;
 
 	glfwSetWindowUserPointer(m_window, this);
 	glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
@@ -18,18 +25,33 @@ Window::Window(const std::string& windowName, int width, int height)
 
 Window::~Window()
 {
+	if (m_headless)
+	{
+		return;
+	}
+
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 }
 
 void Window::update()
 {
+	if (m_headless)
+	{
+		return;
+	}
+
 	glfwPollEvents();
 }
 
 void Window::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface)
 {
-	bool result = glfwCreateWindowSurface(instance, m_window, nullptr, surface);
+	if (m_headless)
+	{
+		throw std::runtime_error("Cannot create a surface for a headless window");
+	}
+
+	VkResult result = glfwCreateWindowSurface(instance, m_window, nullptr, surface);
 
 	if (result != VK_SUCCESS)
 	{
@@ -39,6 +61,12 @@ void Window::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface)
 
 bool Window::shouldClose()
 {
+	// A headless window is never closed, the owner decides when to stop rendering
+	if (m_headless)
+	{
+		return false;
+	}
+
 	return glfwWindowShouldClose(m_window);
 }
 
@@ -48,4 +76,4 @@ void Window::framebufferResizeCallback(GLFWwindow* glfwWindow, int width, int he
 	window->m_framebufferResized = true;
 	window->m_width = width;
 	window->m_height = height;
-}
+}
\ No newline at end of file
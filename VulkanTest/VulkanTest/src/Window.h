@@ -14,8 +14,11 @@ private:
 	unsigned int m_height;
 	bool m_framebufferResized = false;
 
+	// Without GLFW and a native window, for rendering offscreen on machines without a display
+	bool m_headless;
+
 public:
-	Window(const std::string& windowName, int width, int height);
+	Window(const std::string& windowName, int width, int height, bool headless = false);
 	~Window();
 
 	Window(const Window&) = delete;
@@ -26,6 +29,7 @@ public:
 	void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
 	bool shouldClose();
+	bool isHeadless() const { return m_headless; }
 	VkExtent2D getExtent() { return { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height) }; }
 
 	bool wasWindowResized() { return m_framebufferResized; }
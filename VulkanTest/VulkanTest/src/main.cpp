@@ -1,11 +1,142 @@
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
 #include "Application.h"
 
-int main() {
+int main(int argc, char** argv) {
     
-    Application app;
+    Application::Settings settings{};
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--mt-recording") == 0)
+        {
+            settings.multithreadedRecording = true;
+        }
+        else if (strcmp(argv[i], "--recording-threads") == 0 && i + 1 < argc)
+        {
+            settings.multithreadedRecording = true;
+            settings.recordingThreadCount = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--occlusion-culling") == 0)
+        {
+            settings.occlusionCulling = true;
+        }
+        else if (strcmp(argv[i], "--gpu-occlusion-culling") == 0)
+        {
+            settings.gpuOcclusionCulling = true;
+        }
+        else if (strcmp(argv[i], "--backface-culling") == 0)
+        {
+            settings.backfaceCulling = true;
+        }
+        else if (strcmp(argv[i], "--depth-prepass") == 0)
+        {
+            settings.depthPrepass = true;
+        }
+        else if (strcmp(argv[i], "--push-constant-transforms") == 0)
+        {
+            settings.pushConstantTransforms = true;
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            settings.framesInFlight = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--timeline-semaphore") == 0)
+        {
+            settings.timelineSemaphore = true;
+        }
+        else if (strcmp(argv[i], "--frame-stats") == 0)
+        {
+            settings.frameStats = true;
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+        {
+            settings.headless = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            settings.frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--gpu-profile") == 0)
+        {
+            settings.gpuProfiling = true;
+        }
+        else if (strcmp(argv[i], "--gpu-profile-file") == 0 && i + 1 < argc)
+        {
+            settings.gpuProfiling = true;
+            settings.gpuProfileFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cpu-profile-file") == 0 && i + 1 < argc)
+        {
+            settings.cpuProfileFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cpu-profile-frames") == 0 && i + 1 < argc)
+        {
+            settings.cpuProfileFrameCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--scene-benchmark") == 0 && i + 1 < argc)
+        {
+            settings.benchmarkFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+        {
+            settings.sceneObjectCount = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--models") == 0 && i + 1 < argc)
+        {
+            settings.sceneModelCount = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--fixed-timestep") == 0 && i + 1 < argc)
+        {
+            settings.fixedTimestep = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--record-camera") == 0 && i + 1 < argc)
+        {
+            settings.cameraRecordFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--play-camera") == 0 && i + 1 < argc)
+        {
+            settings.cameraPlaybackFile = argv[++i];
+        }
+    }
+
+    // Anything that isn't a number ends up as 0 here as well
+    if (settings.framesInFlight < SwapChain::MIN_FRAMES_IN_FLIGHT || settings.framesInFlight > SwapChain::MAX_FRAMES_IN_FLIGHT)
+    {
+        std::cerr << "--frames-in-flight has to be between " << SwapChain::MIN_FRAMES_IN_FLIGHT << " and " << SwapChain::MAX_FRAMES_IN_FLIGHT << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Both of those read the transforms from the object buffer
+    if (settings.pushConstantTransforms && (settings.depthPrepass || settings.gpuOcclusionCulling))
+    {
+        std::cerr << "--push-constant-transforms can't be combined with --depth-prepass or --gpu-occlusion-culling" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The benchmark needs a scene and an end, 1000 objects for 500 frames unless told otherwise
+    if (!settings.benchmarkFile.empty())
+    {
+        if (settings.sceneObjectCount == 0)
+        {
+            settings.sceneObjectCount = 1000;
+        }
+        if (settings.frameCount == 0)
+        {
+            settings.frameCount = settings.benchmarkWarmupFrameCount + 500;
+        }
+    }
+
+    // Nothing ever closes a headless window, so it needs an end as well
+    if (settings.headless && settings.frameCount == 0)
+    {
+        settings.frameCount = 1000;
+        std::cout << "Headless without --frames, stopping after " << settings.frameCount << " frames" << std::endl;
+    }
+
+    Application app{ settings };
 
     try
     {